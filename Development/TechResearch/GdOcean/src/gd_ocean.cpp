@@ -1,9 +1,23 @@
 ﻿#include "gd_ocean.h"
 #include <algorithm>
 #include <cmath>
+#include <random>
 #include <godot_cpp/classes/engine.hpp>
+#include <godot_cpp/classes/image_texture.hpp>
+#include <godot_cpp/classes/os.hpp>
+#include <godot_cpp/classes/performance.hpp>
+#include <godot_cpp/classes/physics_direct_body_state3d.hpp>
+#include <godot_cpp/classes/physics_server3d.hpp>
+#include <godot_cpp/classes/project_settings.hpp>
+#include <godot_cpp/classes/rd_texture_format.hpp>
+#include <godot_cpp/classes/rd_texture_view.hpp>
+#include <godot_cpp/classes/rendering_device.hpp>
+#include <godot_cpp/classes/rendering_server.hpp>
+#include <godot_cpp/classes/texture2drd.hpp>
+#include <godot_cpp/classes/time.hpp>
+#include <godot_cpp/classes/worker_thread_pool.hpp>
 #include <godot_cpp/core/class_db.hpp>
-#include <godot_cpp/variant/utility_functions.hpp>
+#include <godot_cpp/variant/callable_method_pointer.hpp>
 
 using namespace godot;
 using namespace gd_ocean;
@@ -13,215 +27,1918 @@ using namespace gd_ocean;
 void OceanWaveGenerator::_bind_methods() {
   ClassDB::bind_method(D_METHOD("get_wave_height", "x", "z"),
                        &OceanWaveGenerator::get_wave_height);
+  ClassDB::bind_method(D_METHOD("get_displaced_position", "x", "z"),
+                       &OceanWaveGenerator::get_displaced_position);
+  ClassDB::bind_method(D_METHOD("get_wave_normal", "x", "z"),
+                       &OceanWaveGenerator::get_wave_normal);
+  ClassDB::bind_method(D_METHOD("sample_heights", "positions", "filter"),
+                       &OceanWaveGenerator::sample_heights,
+                       DEFVAL(SAMPLE_BILINEAR));
+  ClassDB::bind_method(
+      D_METHOD("sample_heights_and_gradients", "positions", "filter"),
+      &OceanWaveGenerator::sample_heights_and_gradients,
+      DEFVAL(SAMPLE_BILINEAR));
+  ClassDB::bind_method(D_METHOD("compare_fft_accuracy", "resolution"),
+                       &OceanWaveGenerator::compare_fft_accuracy);
+
+  BIND_ENUM_CONSTANT(SAMPLE_BILINEAR);
+  BIND_ENUM_CONSTANT(SAMPLE_CATMULL_ROM);
+
+  BIND_ENUM_CONSTANT(SPECTRUM_PHILLIPS);
+  BIND_ENUM_CONSTANT(SPECTRUM_JONSWAP);
+
+  BIND_ENUM_CONSTANT(FFT_BACKEND_AUTO);
+  BIND_ENUM_CONSTANT(FFT_BACKEND_REFERENCE);
+  BIND_ENUM_CONSTANT(FFT_BACKEND_SIMD);
+  BIND_ENUM_CONSTANT(FFT_BACKEND_THREADED);
+
+  ClassDB::bind_method(D_METHOD("set_spectrum_type", "type"),
+                       &OceanWaveGenerator::set_spectrum_type);
+  ClassDB::bind_method(D_METHOD("get_spectrum_type"),
+                       &OceanWaveGenerator::get_spectrum_type);
+  ADD_PROPERTY(PropertyInfo(Variant::INT, "spectrum_type", PROPERTY_HINT_ENUM,
+                            "Phillips,JONSWAP"),
+               "set_spectrum_type", "get_spectrum_type");
+
+  ClassDB::bind_method(D_METHOD("set_resolution", "resolution"),
+                       &OceanWaveGenerator::set_resolution);
+  ClassDB::bind_method(D_METHOD("get_resolution"),
+                       &OceanWaveGenerator::get_resolution);
+  // resolution and patch_size edit cascade 0; the arrays are stored
+  ADD_PROPERTY(PropertyInfo(Variant::INT, "resolution", PROPERTY_HINT_ENUM,
+                            "16:16,32:32,64:64,128:128,256:256,512:512,"
+                            "1024:1024",
+                            PROPERTY_USAGE_EDITOR),
+               "set_resolution", "get_resolution");
+
+  ClassDB::bind_method(D_METHOD("set_patch_size", "size"),
+                       &OceanWaveGenerator::set_patch_size);
+  ClassDB::bind_method(D_METHOD("get_patch_size"),
+                       &OceanWaveGenerator::get_patch_size);
+  ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "patch_size", PROPERTY_HINT_RANGE,
+                            "1,4096,0.1,suffix:m", PROPERTY_USAGE_EDITOR),
+               "set_patch_size", "get_patch_size");
+
+  ClassDB::bind_method(D_METHOD("set_cascade_patch_sizes", "sizes"),
+                       &OceanWaveGenerator::set_cascade_patch_sizes);
+  ClassDB::bind_method(D_METHOD("get_cascade_patch_sizes"),
+                       &OceanWaveGenerator::get_cascade_patch_sizes);
+  ADD_PROPERTY(PropertyInfo(Variant::PACKED_FLOAT32_ARRAY,
+                            "cascade_patch_sizes"),
+               "set_cascade_patch_sizes", "get_cascade_patch_sizes");
+
+  ClassDB::bind_method(D_METHOD("set_cascade_resolutions", "resolutions"),
+                       &OceanWaveGenerator::set_cascade_resolutions);
+  ClassDB::bind_method(D_METHOD("get_cascade_resolutions"),
+                       &OceanWaveGenerator::get_cascade_resolutions);
+  ADD_PROPERTY(PropertyInfo(Variant::PACKED_INT32_ARRAY,
+                            "cascade_resolutions"),
+               "set_cascade_resolutions", "get_cascade_resolutions");
+
+  ClassDB::bind_method(D_METHOD("set_cascade_update_intervals", "intervals"),
+                       &OceanWaveGenerator::set_cascade_update_intervals);
+  ClassDB::bind_method(D_METHOD("get_cascade_update_intervals"),
+                       &OceanWaveGenerator::get_cascade_update_intervals);
+  ADD_PROPERTY(PropertyInfo(Variant::PACKED_INT32_ARRAY,
+                            "cascade_update_intervals"),
+               "set_cascade_update_intervals", "get_cascade_update_intervals");
+
+  ClassDB::bind_method(D_METHOD("get_cascade_count"),
+                       &OceanWaveGenerator::get_cascade_count);
+
+  ClassDB::bind_method(D_METHOD("set_simulation_rate", "rate"),
+                       &OceanWaveGenerator::set_simulation_rate);
+  ClassDB::bind_method(D_METHOD("get_simulation_rate"),
+                       &OceanWaveGenerator::get_simulation_rate);
+  ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "simulation_rate",
+                            PROPERTY_HINT_RANGE, "0,120,1,suffix:Hz"),
+               "set_simulation_rate", "get_simulation_rate");
+
+  ClassDB::bind_method(D_METHOD("set_fft_backend", "backend"),
+                       &OceanWaveGenerator::set_fft_backend);
+  ClassDB::bind_method(D_METHOD("get_fft_backend"),
+                       &OceanWaveGenerator::get_fft_backend);
+  ADD_PROPERTY(PropertyInfo(Variant::INT, "fft_backend", PROPERTY_HINT_ENUM,
+                            "Auto,Reference,SIMD,Threaded"),
+               "set_fft_backend", "get_fft_backend");
+  ClassDB::bind_method(D_METHOD("get_active_fft_backend", "cascade"),
+                       &OceanWaveGenerator::get_active_fft_backend,
+                       DEFVAL(0));
+
+  ClassDB::bind_method(D_METHOD("set_wind_speed", "speed"),
+                       &OceanWaveGenerator::set_wind_speed);
+  ClassDB::bind_method(D_METHOD("get_wind_speed"),
+                       &OceanWaveGenerator::get_wind_speed);
+  ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "wind_speed", PROPERTY_HINT_RANGE,
+                            "0.1,60,0.1,suffix:m/s"),
+               "set_wind_speed", "get_wind_speed");
+
+  ClassDB::bind_method(D_METHOD("set_wind_direction", "direction"),
+                       &OceanWaveGenerator::set_wind_direction);
+  ClassDB::bind_method(D_METHOD("get_wind_direction"),
+                       &OceanWaveGenerator::get_wind_direction);
+  ADD_PROPERTY(PropertyInfo(Variant::VECTOR2, "wind_direction"),
+               "set_wind_direction", "get_wind_direction");
+
+  ClassDB::bind_method(D_METHOD("set_fetch", "fetch"),
+                       &OceanWaveGenerator::set_fetch);
+  ClassDB::bind_method(D_METHOD("get_fetch"), &OceanWaveGenerator::get_fetch);
+  ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "fetch", PROPERTY_HINT_RANGE,
+                            "1,2000,1,suffix:km"),
+               "set_fetch", "get_fetch");
+
+  ClassDB::bind_method(D_METHOD("set_peak_enhancement", "gamma"),
+                       &OceanWaveGenerator::set_peak_enhancement);
+  ClassDB::bind_method(D_METHOD("get_peak_enhancement"),
+                       &OceanWaveGenerator::get_peak_enhancement);
+  ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "peak_enhancement",
+                            PROPERTY_HINT_RANGE, "1,7,0.1"),
+               "set_peak_enhancement", "get_peak_enhancement");
+
+  ClassDB::bind_method(D_METHOD("set_phillips_amplitude", "amplitude"),
+                       &OceanWaveGenerator::set_phillips_amplitude);
+  ClassDB::bind_method(D_METHOD("get_phillips_amplitude"),
+                       &OceanWaveGenerator::get_phillips_amplitude);
+  ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "phillips_amplitude",
+                            PROPERTY_HINT_RANGE, "0,0.1,0.0001"),
+               "set_phillips_amplitude", "get_phillips_amplitude");
+
+  ClassDB::bind_method(D_METHOD("set_seed", "seed"),
+                       &OceanWaveGenerator::set_seed);
+  ClassDB::bind_method(D_METHOD("get_seed"), &OceanWaveGenerator::get_seed);
+  ADD_PROPERTY(PropertyInfo(Variant::INT, "seed"), "set_seed", "get_seed");
+
+  ClassDB::bind_method(D_METHOD("set_choppiness", "choppiness"),
+                       &OceanWaveGenerator::set_choppiness);
+  ClassDB::bind_method(D_METHOD("get_choppiness"),
+                       &OceanWaveGenerator::get_choppiness);
+  ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "choppiness", PROPERTY_HINT_RANGE,
+                            "0,3,0.01"),
+               "set_choppiness", "get_choppiness");
+
+  ClassDB::bind_method(D_METHOD("set_loop_period", "period"),
+                       &OceanWaveGenerator::set_loop_period);
+  ClassDB::bind_method(D_METHOD("get_loop_period"),
+                       &OceanWaveGenerator::get_loop_period);
+  ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "loop_period", PROPERTY_HINT_RANGE,
+                            "0,600,0.1,suffix:s"),
+               "set_loop_period", "get_loop_period");
+
+  ClassDB::bind_method(D_METHOD("set_loop_frame_count", "count"),
+                       &OceanWaveGenerator::set_loop_frame_count);
+  ClassDB::bind_method(D_METHOD("get_loop_frame_count"),
+                       &OceanWaveGenerator::get_loop_frame_count);
+  ADD_PROPERTY(PropertyInfo(Variant::INT, "loop_frame_count",
+                            PROPERTY_HINT_RANGE, "2,1024,1"),
+               "set_loop_frame_count", "get_loop_frame_count");
+
+  ClassDB::bind_method(D_METHOD("set_loop_cache_path", "path"),
+                       &OceanWaveGenerator::set_loop_cache_path);
+  ClassDB::bind_method(D_METHOD("get_loop_cache_path"),
+                       &OceanWaveGenerator::get_loop_cache_path);
+  ADD_PROPERTY(PropertyInfo(Variant::STRING, "loop_cache_path",
+                            PROPERTY_HINT_FILE, "*.cache"),
+               "set_loop_cache_path", "get_loop_cache_path");
+
+  ClassDB::bind_method(D_METHOD("set_export_textures", "enabled"),
+                       &OceanWaveGenerator::set_export_textures);
+  ClassDB::bind_method(D_METHOD("get_export_textures"),
+                       &OceanWaveGenerator::get_export_textures);
+  ADD_PROPERTY(PropertyInfo(Variant::BOOL, "export_textures"),
+               "set_export_textures", "get_export_textures");
+
+  ClassDB::bind_method(D_METHOD("get_displacement_texture", "cascade"),
+                       &OceanWaveGenerator::get_displacement_texture,
+                       DEFVAL(0));
+  ClassDB::bind_method(D_METHOD("get_normal_texture", "cascade"),
+                       &OceanWaveGenerator::get_normal_texture, DEFVAL(0));
+  ClassDB::bind_method(D_METHOD("get_foam_texture", "cascade"),
+                       &OceanWaveGenerator::get_foam_texture, DEFVAL(0));
+
+  ClassDB::bind_method(D_METHOD("set_foam_threshold", "threshold"),
+                       &OceanWaveGenerator::set_foam_threshold);
+  ClassDB::bind_method(D_METHOD("get_foam_threshold"),
+                       &OceanWaveGenerator::get_foam_threshold);
+  ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "foam_threshold",
+                            PROPERTY_HINT_RANGE, "-1,1,0.01"),
+               "set_foam_threshold", "get_foam_threshold");
+
+  ClassDB::bind_method(D_METHOD("set_foam_decay", "decay"),
+                       &OceanWaveGenerator::set_foam_decay);
+  ClassDB::bind_method(D_METHOD("get_foam_decay"),
+                       &OceanWaveGenerator::get_foam_decay);
+  ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "foam_decay", PROPERTY_HINT_RANGE,
+                            "0,30,0.01,suffix:s"),
+               "set_foam_decay", "get_foam_decay");
+
+  ClassDB::bind_method(D_METHOD("get_foam_map", "cascade"),
+                       &OceanWaveGenerator::get_foam_map, DEFVAL(0));
+  ClassDB::bind_method(D_METHOD("get_foam_spawn_points", "center",
+                                "min_coverage", "max_points", "cascade"),
+                       &OceanWaveGenerator::get_foam_spawn_points,
+                       DEFVAL(0));
 }
 
-OceanWaveGenerator::OceanWaveGenerator() {
-  time = 0.0;
-  resolution = 64;
-  size = 64.0;
-  init_spectrum();
-  set_process(true);
-}
+OceanWaveGenerator::OceanWaveGenerator() {
+  time = 0.0;
+  cascade_patch_sizes.push_back(64.0f);
+  cascade_resolutions.push_back(64);
+  cascade_update_intervals.push_back(1);
+
+  // Split the 2D transform passes across the engine's worker threads
+  fft_parallel_for = [this](int p_count,
+                            const std::function<void(int)> &p_job) {
+    WorkerThreadPool *pool = WorkerThreadPool::get_singleton();
+    group_job = &p_job;
+    int64_t task = pool->add_group_task(
+        callable_mp(this, &OceanWaveGenerator::run_group_job), p_count, -1,
+        true, "OceanWaveGenerator FFT");
+    pool->wait_for_group_task_completion(task);
+    group_job = nullptr;
+  };
+
+  // Spectrum and buffers are built on the first _process, after the
+  // scene has assigned the exported properties
+  set_process(true);
+}
+
+OceanWaveGenerator::~OceanWaveGenerator() {
+  cancel_loop_build();
+  wait_for_simulation();
+  PackedInt64Array rd_sets;
+  for (std::unique_ptr<Cascade> &cascade : cascades) {
+    free_textures(*cascade, rd_sets);
+  }
+  queue_free_rd_sets(rd_sets);
+}
+
+void OceanWaveGenerator::_notification(int p_what) {
+  // Paired with EXIT_TREE; READY comes only once, so a node moved to
+  // another parent would lose its monitors
+  if (p_what == NOTIFICATION_ENTER_TREE &&
+      !Engine::get_singleton()->is_editor_hint()) {
+    register_monitors();
+  }
+  if (p_what == NOTIFICATION_EXIT_TREE || p_what == NOTIFICATION_PREDELETE) {
+    wait_for_simulation();
+    unregister_monitors();
+  }
+}
+
+static const char *const MONITOR_NAMES[] = {
+    "Ocean/Spectrum update (ms)",
+    "Ocean/FFT (ms)",
+    "Ocean/Samples per tick",
+    "Ocean/Sample batch size",
+    "Ocean/Phase cache hit rate (%)",
+    "Ocean/Thread utilisation (%)",
+};
+
+void OceanWaveGenerator::register_monitors() {
+  Performance *performance = Performance::get_singleton();
+  if (monitors_registered || performance->has_custom_monitor(MONITOR_NAMES[0]))
+    return;
+  for (int i = 0; i < MONITOR_COUNT; ++i) {
+    Array arguments;
+    arguments.push_back(i);
+    performance->add_custom_monitor(
+        MONITOR_NAMES[i], callable_mp(this, &OceanWaveGenerator::get_monitor),
+        arguments);
+  }
+  monitors_registered = true;
+  monitor_window_usec = Time::get_singleton()->get_ticks_usec();
+}
+
+void OceanWaveGenerator::unregister_monitors() {
+  if (!monitors_registered)
+    return;
+  Performance *performance = Performance::get_singleton();
+  for (int i = 0; i < MONITOR_COUNT; ++i) {
+    if (performance->has_custom_monitor(MONITOR_NAMES[i]))
+      performance->remove_custom_monitor(MONITOR_NAMES[i]);
+  }
+  monitors_registered = false;
+}
+
+void OceanWaveGenerator::update_monitors() {
+  int64_t points = sampled_points.exchange(0, std::memory_order_relaxed);
+  int64_t calls = sample_calls.exchange(0, std::memory_order_relaxed);
+  monitor_values[MONITOR_SAMPLES] = (double)points;
+  monitor_values[MONITOR_BATCH_SIZE] = calls > 0 ? (double)points / calls : 0.0;
+
+  uint64_t now = Time::get_singleton()->get_ticks_usec();
+  uint64_t elapsed = now - monitor_window_usec;
+  if (elapsed < 1000000)
+    return;
+  monitor_values[MONITOR_THREAD_UTILISATION] =
+      100.0 * monitor_busy_usec / elapsed;
+  monitor_values[MONITOR_CACHE_HIT_RATE] =
+      monitor_phase_updates > 0
+          ? 100.0 * monitor_phase_hits / monitor_phase_updates
+          : 0.0;
+  monitor_window_usec = now;
+  monitor_busy_usec = 0;
+  monitor_phase_hits = 0;
+  monitor_phase_updates = 0;
+}
+
+double OceanWaveGenerator::get_monitor(int p_monitor) const {
+  ERR_FAIL_INDEX_V(p_monitor, MONITOR_COUNT, 0.0);
+  return monitor_values[p_monitor];
+}
+
+void OceanWaveGenerator::wait_for_simulation() {
+  if (sim_task < 0)
+    return;
+  WorkerThreadPool::get_singleton()->wait_for_task_completion(sim_task);
+  sim_task = -1;
+
+  const TaskTimings &t = task_timings;
+  monitor_values[MONITOR_SPECTRUM_TIME] = t.spectrum_usec / 1000.0;
+  monitor_values[MONITOR_FFT_TIME] = t.fft_usec / 1000.0;
+  if (t.end_usec > t.start_usec)
+    monitor_busy_usec += t.end_usec - t.start_usec;
+  monitor_phase_hits += t.phase_hits;
+  monitor_phase_updates += t.phase_updates;
+  for (std::unique_ptr<Cascade> &cascade : cascades) {
+    if (!cascade->sim_pending)
+      continue;
+    cascade->sim_pending = false;
+    cascade->sim_ready = true;
+  }
+}
+
+int OceanWaveGenerator::get_back_frame(const Cascade &p_cascade) {
+  int front = p_cascade.front_frame.load(std::memory_order_relaxed);
+  int previous = p_cascade.previous_frame.load(std::memory_order_relaxed);
+  for (int i = 0; i < 3; ++i) {
+    if (i != front && i != previous)
+      return i;
+  }
+  return 0;
+}
+
+void OceanWaveGenerator::publish_frame(Cascade &p_cascade) {
+  // Previous first: a reader racing this sees either pair, never the
+  // back frame
+  p_cascade.previous_frame.store(
+      p_cascade.front_frame.load(std::memory_order_relaxed),
+      std::memory_order_release);
+  p_cascade.front_frame.store(p_cascade.sim_target, std::memory_order_release);
+  p_cascade.sim_ready = false;
+  if (export_textures)
+    update_textures(p_cascade);
+}
+
+void OceanWaveGenerator::run_group_job(uint32_t p_index) {
+  (*group_job)((int)p_index);
+}
+
+OceanFFTPlan *OceanWaveGenerator::get_fft_plan(int p_resolution) {
+  std::map<int, std::unique_ptr<OceanFFTPlan>>::iterator it =
+      fft_plans.find(p_resolution);
+  if (it != fft_plans.end())
+    return it->second.get();
+  std::unique_ptr<OceanFFTPlan> &plan = fft_plans[p_resolution];
+  if (fft_backend == FFT_BACKEND_AUTO)
+    plan = benchmark_fft_plans(p_resolution);
+  else
+    plan = create_fft_plan(fft_backend, p_resolution);
+  return plan.get();
+}
+
+std::unique_ptr<OceanFFTPlan>
+OceanWaveGenerator::create_fft_plan(FFTBackend p_backend, int p_resolution) {
+  std::unique_ptr<OceanFFTPlan> plan;
+  if (p_backend == FFT_BACKEND_REFERENCE) {
+    plan.reset(new OceanReferenceFFT);
+  } else {
+    OceanFFT *engine = new OceanFFT;
+    if (p_backend == FFT_BACKEND_THREADED)
+      engine->set_parallel_for(fft_parallel_for,
+                               OS::get_singleton()->get_processor_count());
+    plan.reset(engine);
+  }
+  plan->setup(p_resolution);
+  return plan;
+}
+
+std::unique_ptr<OceanFFTPlan>
+OceanWaveGenerator::benchmark_fft_plans(int p_resolution) {
+  int n = p_resolution;
+  int count = (n / 2 + 1) * n;
+  std::mt19937 rng(1337);
+  std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+  std::vector<float> source(count * 2);
+  for (float &value : source) {
+    value = dist(rng);
+  }
+  // The transform uses its input as scratch, so every run starts from a
+  // fresh copy
+  std::vector<float> spectra(count * 2 * MAP_COUNT);
+  std::vector<float> output(n * n * MAP_COUNT);
+  float *re[MAP_COUNT];
+  float *im[MAP_COUNT];
+  float *out[MAP_COUNT];
+  for (int f = 0; f < MAP_COUNT; ++f) {
+    re[f] = spectra.data() + f * count * 2;
+    im[f] = re[f] + count;
+    out[f] = output.data() + f * n * n;
+  }
+
+  Time *clock = Time::get_singleton();
+  std::unique_ptr<OceanFFTPlan> best;
+  uint64_t best_usec = 0;
+  // The double precision reference never wins and would stall the first
+  // frame at large resolutions, so it is not a candidate
+  for (FFTBackend backend : {FFT_BACKEND_SIMD, FFT_BACKEND_THREADED}) {
+    std::unique_ptr<OceanFFTPlan> plan = create_fft_plan(backend, n);
+    uint64_t fastest = 0;
+    // Run 0 warms up caches and scratch buffers; a backend already twice
+    // as slow as the best one is not timed any further
+    for (int run = 0; run <= FFT_BENCHMARK_RUNS; ++run) {
+      for (int f = 0; f < MAP_COUNT; ++f) {
+        std::copy(source.begin(), source.end(), re[f]);
+      }
+      uint64_t start = clock->get_ticks_usec();
+      plan->inverse_c2r_batch(re, im, out, MAP_COUNT);
+      uint64_t elapsed = clock->get_ticks_usec() - start;
+      if (run == 0 && best && elapsed > best_usec * 2) {
+        fastest = elapsed;
+        break;
+      }
+      if (run > 0 && (fastest == 0 || elapsed < fastest))
+        fastest = elapsed;
+    }
+    if (!best || fastest < best_usec) {
+      best = std::move(plan);
+      best_usec = fastest;
+    }
+  }
+  return best;
+}
+
+// Zeroed pixels for a new texture of p_bytes bytes
+static PackedByteArray zero_bytes(int p_bytes) {
+  PackedByteArray bytes;
+  bytes.resize(p_bytes);
+  bytes.fill(0);
+  return bytes;
+}
+
+void OceanWaveGenerator::create_textures(Cascade &p_cascade,
+                                         int p_resolution) {
+  int total = p_resolution * p_resolution;
+  RenderingDevice *rd = RenderingServer::get_singleton()->get_rendering_device();
+  if (rd) {
+    p_cascade.displacement_bytes = zero_bytes(total * 4 * sizeof(float));
+    p_cascade.normal_bytes = zero_bytes(total * 4);
+    p_cascade.foam_bytes = zero_bytes(total);
+    // The wrappers outlive resolution changes, so materials that fetched
+    // them follow the new RD textures
+    if (!p_cascade.rd_set) {
+      p_cascade.rd_set = new RDTextureSet;
+      Ref<Texture2D> *textures[3] = {&p_cascade.displacement_texture,
+                                     &p_cascade.normal_texture,
+                                     &p_cascade.foam_texture};
+      for (int i = 0; i < 3; ++i) {
+        p_cascade.rd_set->wrappers[i].instantiate();
+        *textures[i] = p_cascade.rd_set->wrappers[i];
+      }
+    }
+    RenderingServer::get_singleton()->call_on_render_thread(
+        callable_mp_static(&OceanWaveGenerator::create_rd_textures)
+            .bind((uint64_t)(uintptr_t)p_cascade.rd_set, p_resolution));
+  } else {
+    // Each image owns its pixels and update_textures writes them in
+    // place, so no buffer is shared and nothing is copied per frame
+    p_cascade.displacement_image = Image::create_from_data(
+        p_resolution, p_resolution, false, Image::FORMAT_RGBAF,
+        zero_bytes(total * 4 * sizeof(float)));
+    p_cascade.normal_image =
+        Image::create_from_data(p_resolution, p_resolution, false,
+                                Image::FORMAT_RGBA8, zero_bytes(total * 4));
+    p_cascade.foam_image =
+        Image::create_from_data(p_resolution, p_resolution, false,
+                                Image::FORMAT_R8, zero_bytes(total));
+    if (p_cascade.displacement_texture.is_valid()) {
+      Ref<ImageTexture>(p_cascade.displacement_texture)
+          ->set_image(p_cascade.displacement_image);
+      Ref<ImageTexture>(p_cascade.normal_texture)
+          ->set_image(p_cascade.normal_image);
+      Ref<ImageTexture>(p_cascade.foam_texture)->set_image(p_cascade.foam_image);
+    } else {
+      p_cascade.displacement_texture =
+          ImageTexture::create_from_image(p_cascade.displacement_image);
+      p_cascade.normal_texture =
+          ImageTexture::create_from_image(p_cascade.normal_image);
+      p_cascade.foam_texture =
+          ImageTexture::create_from_image(p_cascade.foam_image);
+    }
+  }
+  p_cascade.texture_resolution = p_resolution;
+}
+
+void OceanWaveGenerator::create_rd_textures(uint64_t p_set,
+                                            int p_resolution) {
+  RDTextureSet &set = *(RDTextureSet *)(uintptr_t)p_set;
+  RenderingDevice *rd = RenderingServer::get_singleton()->get_rendering_device();
+  static const RenderingDevice::DataFormat FORMATS[3] = {
+      RenderingDevice::DATA_FORMAT_R32G32B32A32_SFLOAT,
+      RenderingDevice::DATA_FORMAT_R8G8B8A8_UNORM,
+      RenderingDevice::DATA_FORMAT_R8_UNORM};
+  static const int TEXEL_BYTES[3] = {4 * sizeof(float), 4, 1};
+  Ref<RDTextureFormat> format;
+  format.instantiate();
+  format->set_width(p_resolution);
+  format->set_height(p_resolution);
+  format->set_texture_type(RenderingDevice::TEXTURE_TYPE_2D);
+  format->set_usage_bits(RenderingDevice::TEXTURE_USAGE_SAMPLING_BIT |
+                         RenderingDevice::TEXTURE_USAGE_CAN_UPDATE_BIT);
+  Ref<RDTextureView> view;
+  view.instantiate();
+  for (int i = 0; i < 3; ++i) {
+    TypedArray<PackedByteArray> data;
+    data.push_back(zero_bytes(p_resolution * p_resolution * TEXEL_BYTES[i]));
+    format->set_format(FORMATS[i]);
+    RID old = set.rids[i];
+    set.rids[i] = rd->texture_create(format, view, data);
+    // Re-point the wrapper before freeing what it pointed at
+    set.wrappers[i]->set_texture_rd_rid(set.rids[i]);
+    if (old.is_valid())
+      rd->free_rid(old);
+  }
+}
+
+void OceanWaveGenerator::update_rd_textures(
+    uint64_t p_set, const PackedByteArray &p_displacement,
+    const PackedByteArray &p_normal, const PackedByteArray &p_foam) {
+  RDTextureSet &set = *(RDTextureSet *)(uintptr_t)p_set;
+  RenderingDevice *rd = RenderingServer::get_singleton()->get_rendering_device();
+  rd->texture_update(set.rids[0], 0, p_displacement);
+  rd->texture_update(set.rids[1], 0, p_normal);
+  rd->texture_update(set.rids[2], 0, p_foam);
+}
+
+void OceanWaveGenerator::free_rd_sets(const PackedInt64Array &p_sets) {
+  RenderingDevice *rd = RenderingServer::get_singleton()->get_rendering_device();
+  for (int64_t s = 0; s < p_sets.size(); ++s) {
+    RDTextureSet *set = (RDTextureSet *)(uintptr_t)p_sets[s];
+    for (int i = 0; i < 3; ++i) {
+      // Detach the wrapper a material may still hold
+      set->wrappers[i]->set_texture_rd_rid(RID());
+      if (set->rids[i].is_valid() && rd)
+        rd->free_rid(set->rids[i]);
+    }
+    delete set;
+  }
+}
+
+void OceanWaveGenerator::queue_free_rd_sets(const PackedInt64Array &p_sets) {
+  if (p_sets.is_empty())
+    return;
+  // Queued after every create and update of these sets, so it runs last
+  // and nothing on the main thread waits for it
+  RenderingServer::get_singleton()->call_on_render_thread(
+      callable_mp_static(&OceanWaveGenerator::free_rd_sets).bind(p_sets));
+}
+
+void OceanWaveGenerator::free_textures(Cascade &p_cascade,
+                                       PackedInt64Array &r_rd_sets) {
+  if (p_cascade.rd_set) {
+    r_rd_sets.push_back((int64_t)(uintptr_t)p_cascade.rd_set);
+    p_cascade.rd_set = nullptr;
+  }
+  p_cascade.displacement_texture.unref();
+  p_cascade.normal_texture.unref();
+  p_cascade.foam_texture.unref();
+  p_cascade.displacement_image.unref();
+  p_cascade.normal_image.unref();
+  p_cascade.foam_image.unref();
+  p_cascade.displacement_bytes = PackedByteArray();
+  p_cascade.normal_bytes = PackedByteArray();
+  p_cascade.foam_bytes = PackedByteArray();
+  p_cascade.texture_resolution = 0;
+}
+
+void OceanWaveGenerator::update_textures(Cascade &p_cascade) {
+  const Frame &frame =
+      p_cascade.frames[p_cascade.front_frame.load(std::memory_order_acquire)];
+  int n = frame.resolution;
+  if (n == 0 || frame.maps[MAP_HEIGHT].empty())
+    return;
+  if (n != p_cascade.texture_resolution)
+    create_textures(p_cascade, n);
+
+  const float *height = frame.maps[MAP_HEIGHT].data();
+  const float *dx = frame.maps[MAP_DISPLACEMENT_X].data();
+  const float *dz = frame.maps[MAP_DISPLACEMENT_Z].data();
+  const float *sx = frame.maps[MAP_SLOPE_X].data();
+  const float *sz = frame.maps[MAP_SLOPE_Z].data();
+  float *disp;
+  uint8_t *nrm;
+  uint8_t *foam;
+  if (p_cascade.rd_set) {
+    disp = (float *)p_cascade.displacement_bytes.ptrw();
+    nrm = p_cascade.normal_bytes.ptrw();
+    foam = p_cascade.foam_bytes.ptrw();
+  } else {
+    disp = (float *)p_cascade.displacement_image->ptrw();
+    nrm = p_cascade.normal_image->ptrw();
+    foam = p_cascade.foam_image->ptrw();
+  }
+  int total = n * n;
+  for (int i = 0; i < total; ++i) {
+    disp[i * 4 + 0] = dx[i];
+    disp[i * 4 + 1] = height[i];
+    disp[i * 4 + 2] = dz[i];
+    disp[i * 4 + 3] = 0.0f;
+
+    // Same height-field normal as get_wave_normal
+    float inv = 1.0f / std::sqrt(sx[i] * sx[i] + sz[i] * sz[i] + 1.0f);
+    nrm[i * 4 + 0] = (uint8_t)((-sx[i] * inv * 0.5f + 0.5f) * 255.0f + 0.5f);
+    nrm[i * 4 + 1] = (uint8_t)((inv * 0.5f + 0.5f) * 255.0f + 0.5f);
+    nrm[i * 4 + 2] = (uint8_t)((-sz[i] * inv * 0.5f + 0.5f) * 255.0f + 0.5f);
+    nrm[i * 4 + 3] = 255;
+  }
+  if ((int)frame.foam.size() == total) {
+    for (int i = 0; i < total; ++i) {
+      foam[i] = (uint8_t)(frame.foam[i] * 255.0f + 0.5f);
+    }
+  }
+
+  if (p_cascade.rd_set) {
+    // Uploaded on the render thread straight from the packed buffers. With
+    // a threaded renderer the bound arrays keep this frame's pixels while
+    // the next frame writes its own copy.
+    RenderingServer::get_singleton()->call_on_render_thread(
+        callable_mp_static(&OceanWaveGenerator::update_rd_textures)
+            .bind((uint64_t)(uintptr_t)p_cascade.rd_set,
+                  p_cascade.displacement_bytes, p_cascade.normal_bytes,
+                  p_cascade.foam_bytes));
+  } else {
+    Ref<ImageTexture>(p_cascade.displacement_texture)
+        ->update(p_cascade.displacement_image);
+    Ref<ImageTexture>(p_cascade.normal_texture)->update(p_cascade.normal_image);
+    Ref<ImageTexture>(p_cascade.foam_texture)->update(p_cascade.foam_image);
+  }
+}
+
+// Catmull-Rom weights of the taps at -1, 0, 1, 2 for offset t in [0, 1)
+static void catmull_rom_weights(double t, double *r_weights) {
+  r_weights[0] = ((-t + 2.0) * t - 1.0) * t * 0.5;
+  r_weights[1] = ((3.0 * t - 5.0) * t * t + 2.0) * 0.5;
+  r_weights[2] = ((-3.0 * t + 4.0) * t + 1.0) * t * 0.5;
+  r_weights[3] = (t - 1.0) * t * t * 0.5;
+}
+
+// Filtered, periodic lookup at world (x, z) of p_count maps sharing one
+// n x n grid over 0..size; grid point i sits at i * size / n. Adds
+// p_weight * p_scales[f] * value to r_sums[f]. n is a power of two, so
+// wrapping is a mask and negative coordinates need no fix-up.
+template <typename T>
+static void sample_maps(const T *const *p_maps, const float *p_scales,
+                        int p_count, int p_resolution, double p_size,
+                        double p_weight, bool p_cubic, float x, float z,
+                        double *r_sums) {
+  int n = p_resolution;
+  int mask = n - 1;
+  double texels_per_metre = n / p_size;
+  double gx = x * texels_per_metre;
+  double gz = z * texels_per_metre;
+  double fx = std::floor(gx);
+  double fz = std::floor(gz);
+  int ix = (int)fx;
+  int iz = (int)fz;
+  double tx = gx - fx;
+  double tz = gz - fz;
+
+  if (!p_cubic) {
+    int x0 = ix & mask;
+    int x1 = (ix + 1) & mask;
+    int r0 = (iz & mask) * n;
+    int r1 = ((iz + 1) & mask) * n;
+    double w00 = (1.0 - tx) * (1.0 - tz);
+    double w10 = tx * (1.0 - tz);
+    double w01 = (1.0 - tx) * tz;
+    double w11 = tx * tz;
+    for (int f = 0; f < p_count; ++f) {
+      const T *m = p_maps[f];
+      double v = w00 * m[r0 + x0] + w10 * m[r0 + x1] + w01 * m[r1 + x0] +
+                 w11 * m[r1 + x1];
+      r_sums[f] += p_weight * p_scales[f] * v;
+    }
+    return;
+  }
+
+  double wx[4], wz[4];
+  catmull_rom_weights(tx, wx);
+  catmull_rom_weights(tz, wz);
+  int xs[4], rows[4];
+  for (int k = 0; k < 4; ++k) {
+    xs[k] = (ix - 1 + k) & mask;
+    rows[k] = ((iz - 1 + k) & mask) * n;
+  }
+  for (int f = 0; f < p_count; ++f) {
+    const T *m = p_maps[f];
+    double v = 0.0;
+    for (int j = 0; j < 4; ++j) {
+      const T *row = m + rows[j];
+      v += wz[j] * (wx[0] * row[xs[0]] + wx[1] * row[xs[1]] +
+                    wx[2] * row[xs[2]] + wx[3] * row[xs[3]]);
+    }
+    r_sums[f] += p_weight * p_scales[f] * v;
+  }
+}
+
+int OceanWaveGenerator::get_sample_layers(const MapField *p_fields,
+                                          int p_count,
+                                          SampleLayer *r_layers) const {
+  int layer_count = 0;
+
+  if (loop_cache.is_open()) {
+    // Straight from the mapped file: two frames, blended in time
+    int frames = loop_cache.get_frame_count();
+    double period = loop_cache.get_period();
+    double t = std::fmod(time, period);
+    if (t < 0)
+      t += period;
+    double position = t / period * frames;
+    int f0 = std::min((int)position, frames - 1);
+    int f1 = (f0 + 1) % frames;
+    double blend = position - f0;
+    int cascade_count = std::min(loop_cache.get_cascade_count(), MAX_CASCADES);
+    for (int c = 0; c < cascade_count; ++c) {
+      const OceanLoopCache::CascadeInfo &info = loop_cache.get_cascade(c);
+      for (int k = 0; k < 2; ++k) {
+        SampleLayer &layer = r_layers[layer_count++];
+        int frame = k == 0 ? f0 : f1;
+        for (int f = 0; f < p_count; ++f) {
+          layer.quantised[f] = loop_cache.get_field(c, frame, p_fields[f]);
+          layer.scales[f] = loop_cache.get_scale(c, frame, p_fields[f]);
+        }
+        layer.resolution = (int)info.resolution;
+        layer.size = info.size;
+        layer.weight = k == 0 ? 1.0 - blend : blend;
+      }
+    }
+    return layer_count;
+  }
+
+  for (const std::unique_ptr<Cascade> &cascade : cascades) {
+    const Frame &front =
+        cascade->frames[cascade->front_frame.load(std::memory_order_acquire)];
+    const Frame &previous =
+        cascade->frames[cascade->previous_frame.load(std::memory_order_acquire)];
+    if (front.resolution == 0 || front.maps[MAP_HEIGHT].empty())
+      continue;
+    // Only the front frame when simulating every _process, where the
+    // clock is already past it
+    double blend = 1.0;
+    if (&previous != &front && front.time > previous.time &&
+        previous.resolution == front.resolution)
+      blend = std::min(std::max((time - previous.time) /
+                                    (front.time - previous.time),
+                                0.0),
+                       1.0);
+    for (int k = 0; k < 2; ++k) {
+      const Frame &frame = k == 0 ? previous : front;
+      double weight = k == 0 ? 1.0 - blend : blend;
+      if (weight <= 0.0)
+        continue;
+      SampleLayer &layer = r_layers[layer_count++];
+      for (int f = 0; f < p_count; ++f) {
+        layer.maps[f] = frame.maps[p_fields[f]].data();
+        layer.scales[f] = 1.0f;
+      }
+      layer.resolution = frame.resolution;
+      layer.size = frame.size;
+      layer.weight = weight;
+    }
+  }
+  return layer_count;
+}
+
+void OceanWaveGenerator::sample_layers(const SampleLayer *p_layers,
+                                       int p_layer_count, int p_count,
+                                       bool p_cubic, float x, float z,
+                                       double *r_sums) {
+  for (int f = 0; f < p_count; ++f) {
+    r_sums[f] = 0.0;
+  }
+  for (int l = 0; l < p_layer_count; ++l) {
+    const SampleLayer &layer = p_layers[l];
+    if (layer.quantised[0]) {
+      sample_maps(layer.quantised, layer.scales, p_count, layer.resolution,
+                  layer.size, layer.weight, p_cubic, x, z, r_sums);
+    } else {
+      sample_maps(layer.maps, layer.scales, p_count, layer.resolution,
+                  layer.size, layer.weight, p_cubic, x, z, r_sums);
+    }
+  }
+}
+
+float OceanWaveGenerator::sample_map(MapField p_field, float x,
+                                     float z) const {
+  sampled_points.fetch_add(1, std::memory_order_relaxed);
+  sample_calls.fetch_add(1, std::memory_order_relaxed);
+  SampleLayer layers[MAX_SAMPLE_LAYERS];
+  int layer_count = get_sample_layers(&p_field, 1, layers);
+  double sum;
+  sample_layers(layers, layer_count, 1, false, x, z, &sum);
+  return (float)sum;
+}
+
+void OceanWaveGenerator::sample_batch(const Vector3 *p_positions, int p_count,
+                                      SampleFilter p_filter, float *r_heights,
+                                      Vector2 *r_gradients) const {
+  const MapField fields[3] = {MAP_HEIGHT, MAP_SLOPE_X, MAP_SLOPE_Z};
+  int field_count = r_gradients ? 3 : 1;
+  sampled_points.fetch_add(p_count, std::memory_order_relaxed);
+  sample_calls.fetch_add(1, std::memory_order_relaxed);
+  // Layers are resolved once, so per point only the filter taps remain
+  SampleLayer layers[MAX_SAMPLE_LAYERS];
+  int layer_count = get_sample_layers(fields, field_count, layers);
+  bool cubic = p_filter == SAMPLE_CATMULL_ROM;
+
+  for (int i = 0; i < p_count; ++i) {
+    double sums[3];
+    sample_layers(layers, layer_count, field_count, cubic,
+                  (float)p_positions[i].x,
+                  (float)p_positions[i].z, sums);
+    r_heights[i] = (float)sums[0];
+    if (r_gradients)
+      r_gradients[i] = Vector2((float)sums[1], (float)sums[2]);
+  }
+}
+
+PackedFloat32Array
+OceanWaveGenerator::sample_heights(const PackedVector3Array &p_positions,
+                                   SampleFilter p_filter) const {
+  PackedFloat32Array heights;
+  heights.resize(p_positions.size());
+  sample_batch(p_positions.ptr(), (int)p_positions.size(), p_filter,
+               heights.ptrw(), nullptr);
+  return heights;
+}
+
+PackedVector3Array OceanWaveGenerator::sample_heights_and_gradients(
+    const PackedVector3Array &p_positions, SampleFilter p_filter) const {
+  int count = (int)p_positions.size();
+  std::vector<float> heights(count);
+  std::vector<Vector2> gradients(count);
+  sample_batch(p_positions.ptr(), count, p_filter, heights.data(),
+               gradients.data());
+  PackedVector3Array result;
+  result.resize(count);
+  Vector3 *out = result.ptrw();
+  for (int i = 0; i < count; ++i) {
+    out[i] = Vector3(gradients[i].x, heights[i], gradients[i].y);
+  }
+  return result;
+}
+
+float OceanWaveGenerator::get_wave_height(float x, float z) {
+  return sample_map(MAP_HEIGHT, x, z);
+}
+
+Vector3 OceanWaveGenerator::get_displaced_position(float x, float z) const {
+  return Vector3(x + sample_map(MAP_DISPLACEMENT_X, x, z),
+                 sample_map(MAP_HEIGHT, x, z),
+                 z + sample_map(MAP_DISPLACEMENT_Z, x, z));
+}
+
+Vector3 OceanWaveGenerator::get_wave_normal(float x, float z) const {
+  // Height-field normal; ignores the small tilt added by choppy displacement
+  return Vector3(-sample_map(MAP_SLOPE_X, x, z), 1.0f,
+                 -sample_map(MAP_SLOPE_Z, x, z))
+      .normalized();
+}
+
+Dictionary OceanWaveGenerator::compare_fft_accuracy(int p_resolution) {
+  Dictionary result;
+  ERR_FAIL_COND_V_MSG(p_resolution < 4 ||
+                          (p_resolution & (p_resolution - 1)) != 0,
+                      result, "Resolution must be a power of two >= 4.");
+
+  int n = p_resolution;
+  int count = (n / 2 + 1) * n;
+
+  // Fixed seed so results are comparable between runs and machines
+  std::mt19937 rng(1337);
+  std::uniform_real_distribution<double> dist(-1.0, 1.0);
+  std::vector<std::complex<double>> ref_spectrum(count);
+  std::vector<float> f_re(count), f_im(count);
+  for (int i = 0; i < count; ++i) {
+    double re = dist(rng);
+    double im = dist(rng);
+    ref_spectrum[i] = std::complex<double>(re, im);
+    f_re[i] = (float)re;
+    f_im[i] = (float)im;
+  }
+
+  std::vector<double> ref_out(n * n);
+  std::vector<float> f_out(n * n);
+  OceanReferenceFFT reference;
+  reference.setup(n);
+  OceanFFT engine;
+  engine.setup(n);
+
+  Time *clock = Time::get_singleton();
+  uint64_t t0 = clock->get_ticks_usec();
+  reference.inverse_c2r_double(ref_spectrum, ref_out);
+  uint64_t t1 = clock->get_ticks_usec();
+  engine.inverse_c2r(f_re.data(), f_im.data(), f_out.data());
+  uint64_t t2 = clock->get_ticks_usec();
+
+  double max_err = 0.0;
+  double max_ref = 0.0;
+  double sum_sq = 0.0;
+  for (int i = 0; i < n * n; ++i) {
+    double err = std::abs((double)f_out[i] - ref_out[i]);
+    max_err = std::max(max_err, err);
+    max_ref = std::max(max_ref, std::abs(ref_out[i]));
+    sum_sq += err * err;
+  }
+
+  result["resolution"] = n;
+  result["simd"] = OceanFFT::get_simd_level_name(engine.get_simd_level());
+  result["max_abs_error"] = max_err;
+  result["rms_error"] = std::sqrt(sum_sq / (n * n));
+  result["max_relative_error"] = max_ref > 0.0 ? max_err / max_ref : 0.0;
+  result["double_usec"] = (int64_t)(t1 - t0);
+  result["float_usec"] = (int64_t)(t2 - t1);
+  return result;
+}
+
+void OceanWaveGenerator::_process(double delta) {
+  if (Engine::get_singleton()->is_editor_hint())
+    return;
+
+  if (monitors_registered)
+    update_monitors();
+
+  WorkerThreadPool *pool = WorkerThreadPool::get_singleton();
+  time += delta;
+
+  // Publish finished frames once the clock has reached the keyframe they
+  // follow, so the front pair always brackets the current time. This is
+  // the only place the front buffers change.
+  if (sim_task >= 0 && pool->is_task_completed(sim_task))
+    wait_for_simulation();
+  for (std::unique_ptr<Cascade> &cascade : cascades) {
+    if (cascade->sim_ready &&
+        time >= cascade->frames[cascade->front_frame.load()].time)
+      publish_frame(*cascade);
+  }
+
+  if (cascades_dirty || noise_dirty || spectrum_dirty || loop_dirty ||
+      fft_dirty) {
+    wait_for_simulation();
+    init_spectrum();
+  }
+
+  if (loop_build_task >= 0 && pool->is_task_completed(loop_build_task))
+    finish_loop_build();
+
+  if (loop_cache.is_open()) {
+    // Point queries read the cache directly; full frames are only
+    // decoded when something draws them or asks for foam
+    if (export_textures)
+      sync_loop_frames();
+    return;
+  }
+  for (std::unique_ptr<Cascade> &cascade : cascades) {
+    cascade->frames_since_update++;
+  }
+
+  // Still busy with an earlier frame: skip rather than queue up work
+  if (sim_task >= 0)
+    return;
+
+  bool any_due = false;
+  for (std::unique_ptr<Cascade> &cascade : cascades) {
+    // A finished frame holds the back buffer until it is published
+    if (cascade->sim_ready)
+      continue;
+    double target = time;
+    if (simulation_rate > 0.0f) {
+      // Next keyframe on a fixed step, started as soon as the previous one
+      // is out so it is ready when the clock gets there. A constant step
+      // also keeps the phase recurrence running.
+      double step = cascade->update_interval / (double)simulation_rate;
+      target = cascade->frames[cascade->front_frame.load()].time + step;
+      if (target < time)
+        target = time; // fell behind, restart the schedule from now
+    } else {
+      if (cascade->frames_since_update < cascade->update_interval)
+        continue;
+      cascade->frames_since_update = 0;
+    }
+    cascade->sim_target = get_back_frame(*cascade);
+    cascade->sim_time = target;
+    cascade->sim_pending = true;
+    any_due = true;
+  }
+  if (!any_due)
+    return;
+
+  sim_choppiness = choppiness;
+  sim_foam_threshold = foam_threshold;
+  sim_foam_decay = foam_decay;
+  task_timings = TaskTimings();
+  task_timings.start_usec = Time::get_singleton()->get_ticks_usec();
+  sim_task = pool->add_task(callable_mp(this, &OceanWaveGenerator::simulate_frame),
+                            true, "OceanWaveGenerator simulation");
+}
+
+void OceanWaveGenerator::advance_phase(Cascade &p_cascade, double p_time,
+                                       TaskTimings &r_timings) {
+  const double TWO_PI = 6.28318530717958647692;
+  Cascade &c = p_cascade;
+  int count = (int)c.dispersion.size();
+  double dt = p_time - c.phase_time;
+  bool same_step = std::abs(dt - c.phase_step) < 1e-6;
+
+  r_timings.phase_updates++;
+  if (c.phase_valid && same_step && c.phase_steps < PHASE_RESYNC_INTERVAL) {
+    r_timings.phase_hits++;
+    float *pr = c.phase_re.data();
+    float *pi = c.phase_im.data();
+    const float *rr = c.rotation_re.data();
+    const float *ri = c.rotation_im.data();
+    for (int i = 0; i < count; ++i) {
+      float r = pr[i] * rr[i] - pi[i] * ri[i];
+      pi[i] = pr[i] * ri[i] + pi[i] * rr[i];
+      pr[i] = r;
+    }
+    c.phase_time = p_time;
+    c.phase_steps++;
+    return;
+  }
+
+  // Exact phase, and a new rotation table when the step has changed
+  bool rebuild = c.phase_valid && !same_step && dt > 0.0;
+  for (int i = 0; i < count; ++i) {
+    double w = c.dispersion[i];
+    double phase = std::fmod(w * p_time, TWO_PI);
+    c.phase_re[i] = (float)std::cos(phase);
+    c.phase_im[i] = (float)std::sin(phase);
+    if (rebuild) {
+      c.rotation_re[i] = (float)std::cos(w * dt);
+      c.rotation_im[i] = (float)std::sin(w * dt);
+    }
+  }
+  if (rebuild)
+    c.phase_step = dt;
+  c.phase_time = p_time;
+  c.phase_steps = 0;
+  c.phase_valid = true;
+}
+
+void OceanWaveGenerator::simulate_frame() {
+  for (std::unique_ptr<Cascade> &cascade : cascades) {
+    if (!cascade->sim_pending)
+      continue;
+    simulate_cascade(*cascade, sim_choppiness, task_timings);
+    const Frame &previous =
+        cascade->frames[cascade->front_frame.load(std::memory_order_relaxed)];
+    update_foam(cascade->frames[cascade->sim_target], previous);
+  }
+  task_timings.end_usec = Time::get_singleton()->get_ticks_usec();
+}
+
+void OceanWaveGenerator::simulate_cascade(Cascade &p_cascade,
+                                          float p_choppiness,
+                                          TaskTimings &r_timings) {
+  Cascade &c = p_cascade;
+  int n = c.resolution;
+  int count = (n / 2 + 1) * n;
+  Frame &frame = c.frames[c.sim_target];
+
+  // 1. H(k, t) on the kx >= 0 half plane:
+  // H(k) = h0(k) e^{iwt} + conj(h0(-k)) e^{-iwt}, Hermitian by construction
+  // The other fields follow from H:
+  //   Dx = -i lambda kx/|k| H, Dz = -i lambda kz/|k| H
+  //   dh/dx = i kx H,          dh/dz = i kz H
+  //   dDx/dx = lambda kx^2/|k| H, dDz/dz = lambda kz^2/|k| H,
+  //   dDx/dz = lambda kx kz/|k| H
+  Time *clock = Time::get_singleton();
+  uint64_t t0 = clock->get_ticks_usec();
+  advance_phase(c, c.sim_time, r_timings);
+
+  float *re[MAP_COUNT];
+  float *im[MAP_COUNT];
+  float *out[MAP_COUNT];
+  for (int f = 0; f < MAP_COUNT; ++f) {
+    re[f] = c.spectrum_re[f].data();
+    im[f] = c.spectrum_im[f].data();
+    out[f] = frame.maps[f].data();
+  }
+  const float *pr = c.phase_re.data();
+  const float *pi = c.phase_im.data();
+  const float *ar = c.h0_re.data();
+  const float *ai = c.h0_im.data();
+  const float *br = c.h0_minus_re.data();
+  const float *bi = c.h0_minus_im.data();
+  const float *kx = c.odd_kx.data();
+  const float *kz = c.odd_kz.data();
+  const float *dx = c.dir_x.data();
+  const float *dz = c.dir_z.data();
+  const float *jxx = c.jacobian_xx.data();
+  const float *jzz = c.jacobian_zz.data();
+  const float *jxz = c.jacobian_xz.data();
+  float lambda = p_choppiness;
+
+  // Branch free: k = 0 has h0 = 0 and the Nyquist masks live in the tables
+  for (int i = 0; i < count; ++i) {
+    float hr = (ar[i] + br[i]) * pr[i] - (ai[i] - bi[i]) * pi[i];
+    float hi = (ar[i] - br[i]) * pi[i] + (ai[i] + bi[i]) * pr[i];
+    re[MAP_HEIGHT][i] = hr;
+    im[MAP_HEIGHT][i] = hi;
+
+    float ux = dx[i] * lambda;
+    float uz = dz[i] * lambda;
+    re[MAP_DISPLACEMENT_X][i] = ux * hi;
+    im[MAP_DISPLACEMENT_X][i] = -ux * hr;
+    re[MAP_DISPLACEMENT_Z][i] = uz * hi;
+    im[MAP_DISPLACEMENT_Z][i] = -uz * hr;
+    re[MAP_SLOPE_X][i] = -kx[i] * hi;
+    im[MAP_SLOPE_X][i] = kx[i] * hr;
+    re[MAP_SLOPE_Z][i] = -kz[i] * hi;
+    im[MAP_SLOPE_Z][i] = kz[i] * hr;
+
+    float axx = jxx[i] * lambda;
+    float azz = jzz[i] * lambda;
+    float axz = jxz[i] * lambda;
+    re[MAP_DDX_DX][i] = axx * hr;
+    im[MAP_DDX_DX][i] = axx * hi;
+    re[MAP_DDZ_DZ][i] = azz * hr;
+    im[MAP_DDZ_DZ][i] = azz * hi;
+    re[MAP_DDX_DZ][i] = axz * hr;
+    im[MAP_DDX_DZ][i] = axz * hi;
+  }
+
+  // 2. One batched complex-to-real IFFT for all fields
+  // h0 carries the physical amplitude, so the unnormalised sums are metres
+  uint64_t t1 = clock->get_ticks_usec();
+  c.fft->inverse_c2r_batch(re, im, out, MAP_COUNT);
+  r_timings.spectrum_usec += t1 - t0;
+  r_timings.fft_usec += clock->get_ticks_usec() - t1;
+  frame.time = c.sim_time;
+}
+
+void OceanWaveGenerator::update_foam(Frame &p_frame,
+                                     const Frame &p_previous) const {
+  int total = p_frame.resolution * p_frame.resolution;
+  p_frame.foam.resize(total);
+  float *foam = p_frame.foam.data();
+  const float *xx = p_frame.maps[MAP_DDX_DX].data();
+  const float *zz = p_frame.maps[MAP_DDZ_DZ].data();
+  const float *xz = p_frame.maps[MAP_DDX_DZ].data();
+
+  // Foam left from the previous frame fades as exp(-dt / decay)
+  float decay = 0.0f;
+  double dt = p_frame.time - p_previous.time;
+  if ((int)p_previous.foam.size() == total && dt > 0.0 && sim_foam_decay > 0.0f)
+    decay = (float)std::exp(-dt / sim_foam_decay);
+  const float *previous = decay > 0.0f ? p_previous.foam.data() : nullptr;
+
+  // Coverage ramps from 0 at the threshold to 1 as far below it as the
+  // threshold is below undisturbed water (J = 1), so zero and negative
+  // thresholds still foam where the surface folds
+  float threshold = sim_foam_threshold;
+  float inv_span = 1.0f / std::max(1.0f - threshold, 0.01f);
+  for (int i = 0; i < total; ++i) {
+    // J = (1 + dDx/dx)(1 + dDz/dz) - dDx/dz dDz/dx
+    float j = (1.0f + xx[i]) * (1.0f + zz[i]) - xz[i] * xz[i];
+    float coverage = std::min(std::max((threshold - j) * inv_span, 0.0f), 1.0f);
+    foam[i] = previous ? std::max(coverage, previous[i] * decay) : coverage;
+  }
+}
+
+// ... (get_wave_height, helpers remain same) ...
+
+// Standard normal pair via Box-Muller on raw mt19937 output, so a given
+// seed gives the same ocean with every standard library
+static std::complex<float> gaussian_pair(std::mt19937 &rng) {
+  const double PI = 3.14159265358979323846;
+  double u1 = ((rng() >> 8) + 0.5) / 16777216.0;
+  double u2 = ((rng() >> 8) + 0.5) / 16777216.0;
+  double r = std::sqrt(-2.0 * std::log(u1));
+  return std::complex<float>((float)(r * std::cos(2.0 * PI * u2)),
+                             (float)(r * std::sin(2.0 * PI * u2)));
+}
+
+double OceanWaveGenerator::evaluate_spectrum(double kx, double kz) const {
+  const double PI = 3.14159265358979323846;
+  const double G = 9.81;
+
+  double k = std::sqrt(kx * kx + kz * kz);
+  if (k < 0.0001)
+    return 0.0;
+
+  Vector2 wind = wind_direction.length() > 0.0001f ? wind_direction.normalized()
+                                                   : Vector2(1.0f, 0.0f);
+  double cos_theta = (kx * wind.x + kz * wind.y) / k;
+  if (cos_theta <= 0.0)
+    return 0.0; // No energy travelling against the wind
+
+  // cos^2 spreading, normalised so it integrates to 1 over theta
+  double spreading = (2.0 / PI) * cos_theta * cos_theta;
+  double U = std::max((double)wind_speed, 0.01);
+
+  if (spectrum_type == SPECTRUM_JONSWAP) {
+    double F = std::max((double)fetch, 0.001) * 1000.0;
+    double alpha = 0.076 * std::pow(U * U / (F * G), 0.22);
+    double omega_p = 22.0 * std::cbrt(G * G / (U * F));
+    double omega = std::sqrt(G * k);
+    double sigma = omega <= omega_p ? 0.07 : 0.09;
+    double d = (omega - omega_p) / (sigma * omega_p);
+    double r = std::exp(-0.5 * d * d);
+    double s_omega = alpha * G * G / std::pow(omega, 5.0) *
+                     std::exp(-1.25 * std::pow(omega_p / omega, 4.0)) *
+                     std::pow((double)peak_enhancement, r);
+    // S(kx, kz) = S(w) * dw/dk / k * D(theta), deep water dw/dk = g / 2w
+    return s_omega * (G / (2.0 * omega)) / k * spreading;
+  }
+
+  // Phillips: S = (alpha / 2) k^-4 D(theta) e^{-1/(kL)^2}, with the
+  // shortest waves (below L / 1000) suppressed
+  double L = U * U / G;
+  double l = L * 0.001;
+  double k2 = k * k;
+  return 0.5 * phillips_amplitude / (k2 * k2) * spreading *
+         std::exp(-1.0 / (k2 * L * L)) * std::exp(-k2 * l * l);
+}
+
+void OceanWaveGenerator::init_spectrum() {
+  if (cascades_dirty)
+    rebuild_cascades();
+
+  if (fft_dirty) {
+    // init_cascade fetches plans of the new backend
+    fft_plans.clear();
+    for (std::unique_ptr<Cascade> &cascade : cascades) {
+      cascade->fft = nullptr;
+    }
+    fft_dirty = false;
+  }
+
+  for (int i = 0; i < (int)cascades.size(); ++i) {
+    Cascade &c = *cascades[i];
+    c.noise_dirty |= noise_dirty;
+    c.spectrum_dirty |= spectrum_dirty;
+    init_cascade(c, i);
+  }
+  noise_dirty = false;
+  spectrum_dirty = false;
+
+  // Whatever changed is baked into the loop cache as well
+  build_loop_cache();
+  loop_dirty = false;
+}
+
+uint64_t OceanWaveGenerator::get_loop_hash() const {
+  // FNV-1a over the parameters, in a fixed order
+  uint64_t hash = 1469598103934665603ULL;
+  auto mix = [&hash](const void *p_data, size_t p_size) {
+    const uint8_t *bytes = (const uint8_t *)p_data;
+    for (size_t i = 0; i < p_size; ++i) {
+      hash = (hash ^ bytes[i]) * 1099511628211ULL;
+    }
+  };
+  int type = (int)spectrum_type;
+  int field_count = MAP_COUNT;
+  mix(&field_count, sizeof(field_count));
+  float wind[2] = {wind_direction.x, wind_direction.y};
+  mix(&loop_period, sizeof(loop_period));
+  mix(&loop_frame_count, sizeof(loop_frame_count));
+  mix(&type, sizeof(type));
+  mix(&wind_speed, sizeof(wind_speed));
+  mix(wind, sizeof(wind));
+  mix(&fetch, sizeof(fetch));
+  mix(&peak_enhancement, sizeof(peak_enhancement));
+  mix(&phillips_amplitude, sizeof(phillips_amplitude));
+  mix(&seed, sizeof(seed));
+  mix(&choppiness, sizeof(choppiness));
+  for (const std::unique_ptr<Cascade> &cascade : cascades) {
+    mix(&cascade->resolution, sizeof(cascade->resolution));
+    mix(&cascade->size, sizeof(cascade->size));
+    mix(&cascade->k_min, sizeof(cascade->k_min));
+    mix(&cascade->k_max, sizeof(cascade->k_max));
+  }
+  return hash;
+}
+
+void OceanWaveGenerator::build_loop_cache() {
+  cancel_loop_build();
+  loop_cache.close();
+  loop_frames_time = -1.0;
+  if (loop_period <= 0.0f)
+    return;
+
+  std::string path =
+      ProjectSettings::get_singleton()->globalize_path(loop_cache_path).utf8().get_data();
+  uint64_t hash = get_loop_hash();
+  if (loop_cache.open(path, hash))
+    return;
+
+  // Written on the pool from copies of the spectrum tables, with plans of
+  // its own, while the live cascades keep simulating
+  loop_build.reset(new LoopBuild);
+  LoopBuild &build = *loop_build;
+  build.path = path;
+  build.hash = hash;
+  build.period = loop_period;
+  build.frame_count = loop_frame_count;
+  build.choppiness = choppiness;
+  for (const std::unique_ptr<Cascade> &cascade : cascades) {
+    const Cascade &src = *cascade;
+    std::unique_ptr<Cascade> copy(new Cascade);
+    Cascade &c = *copy;
+    c.resolution = src.resolution;
+    c.size = src.size;
+    c.h0_re = src.h0_re;
+    c.h0_im = src.h0_im;
+    c.h0_minus_re = src.h0_minus_re;
+    c.h0_minus_im = src.h0_minus_im;
+    c.dispersion = src.dispersion;
+    c.odd_kx = src.odd_kx;
+    c.odd_kz = src.odd_kz;
+    c.dir_x = src.dir_x;
+    c.dir_z = src.dir_z;
+    c.jacobian_xx = src.jacobian_xx;
+    c.jacobian_zz = src.jacobian_zz;
+    c.jacobian_xz = src.jacobian_xz;
+    c.phase_re = src.phase_re;
+    c.phase_im = src.phase_im;
+    c.rotation_re = src.rotation_re;
+    c.rotation_im = src.rotation_im;
+    c.phase_valid = false;
+    for (int f = 0; f < MAP_COUNT; ++f) {
+      c.spectrum_re[f].resize(src.spectrum_re[f].size());
+      c.spectrum_im[f].resize(src.spectrum_im[f].size());
+      c.frames[0].maps[f].resize(src.frames[0].maps[f].size());
+    }
+    c.frames[0].resolution = src.resolution;
+    // Single threaded: the build is one pool task already
+    build.plans.push_back(create_fft_plan(FFT_BACKEND_SIMD, c.resolution));
+    c.fft = build.plans.back().get();
+    build.cascades.push_back(std::move(copy));
+  }
+  loop_build_task = WorkerThreadPool::get_singleton()->add_task(
+      callable_mp(this, &OceanWaveGenerator::run_loop_build), true,
+      "OceanWaveGenerator loop cache");
+}
+
+void OceanWaveGenerator::run_loop_build() {
+  LoopBuild &build = *loop_build;
+  std::vector<OceanLoopCache::CascadeInfo> infos;
+  for (const std::unique_ptr<Cascade> &cascade : build.cascades) {
+    infos.push_back({(uint32_t)cascade->resolution, (float)cascade->size});
+  }
+  // One pass over the loop with a fixed step
+  TaskTimings timings;
+  bool written = OceanLoopCache::write(
+      build.path, build.hash, build.period, build.frame_count, MAP_COUNT,
+      infos, [&](int p_cascade, int p_frame, float *const *p_fields) {
+        if (build.cancel.load(std::memory_order_relaxed))
+          return false;
+        Cascade &c = *build.cascades[p_cascade];
+        c.sim_target = 0;
+        c.sim_time = (double)build.period * p_frame / build.frame_count;
+        simulate_cascade(c, build.choppiness, timings);
+        const Frame &frame = c.frames[0];
+        for (int f = 0; f < MAP_COUNT; ++f) {
+          std::copy(frame.maps[f].begin(), frame.maps[f].end(), p_fields[f]);
+        }
+        return true;
+      });
+  build.written.store(written, std::memory_order_release);
+}
+
+void OceanWaveGenerator::finish_loop_build() {
+  WorkerThreadPool::get_singleton()->wait_for_task_completion(loop_build_task);
+  loop_build_task = -1;
+  std::unique_ptr<LoopBuild> build = std::move(loop_build);
+  if (build->cancel.load(std::memory_order_relaxed))
+    return;
+  // Loop frames are decoded into the back buffers the live task writes
+  wait_for_simulation();
+  ERR_FAIL_COND_MSG(!build->written.load(std::memory_order_acquire) ||
+                        !loop_cache.open(build->path, build->hash),
+                    "Could not write the ocean loop cache, simulating live.");
+}
+
+void OceanWaveGenerator::cancel_loop_build() {
+  if (loop_build_task < 0)
+    return;
+  loop_build->cancel.store(true, std::memory_order_relaxed);
+  finish_loop_build();
+}
+
+void OceanWaveGenerator::sync_loop_frames() {
+  if (!loop_cache.is_open() || loop_frames_time == time)
+    return;
+  sim_foam_threshold = foam_threshold;
+  sim_foam_decay = foam_decay;
+  for (int i = 0; i < (int)cascades.size(); ++i) {
+    decode_loop_frame(i, time);
+    publish_frame(*cascades[i]);
+  }
+  loop_frames_time = time;
+}
+
+void OceanWaveGenerator::decode_loop_frame(int p_cascade, double p_time) {
+  Cascade &c = *cascades[p_cascade];
+  c.sim_target = get_back_frame(c);
+  Frame &frame = c.frames[c.sim_target];
+  int frames = loop_cache.get_frame_count();
+  double period = loop_cache.get_period();
+  double t = std::fmod(p_time, period);
+  if (t < 0)
+    t += period;
+  double position = t / period * frames;
+  int f0 = std::min((int)position, frames - 1);
+  int f1 = (f0 + 1) % frames;
+  float blend = (float)(position - f0);
+
+  int total = c.resolution * c.resolution;
+  for (int f = 0; f < MAP_COUNT; ++f) {
+    const int16_t *a = loop_cache.get_field(p_cascade, f0, f);
+    const int16_t *b = loop_cache.get_field(p_cascade, f1, f);
+    float sa = loop_cache.get_scale(p_cascade, f0, f) * (1.0f - blend);
+    float sb = loop_cache.get_scale(p_cascade, f1, f) * blend;
+    float *out = frame.maps[f].data();
+    for (int i = 0; i < total; ++i) {
+      out[i] = a[i] * sa + b[i] * sb;
+    }
+  }
+  frame.time = p_time;
+  update_foam(frame, c.frames[c.front_frame.load(std::memory_order_relaxed)]);
+}
+
+void OceanWaveGenerator::rebuild_cascades() {
+  int count = std::max(1, std::min((int)cascade_patch_sizes.size(),
+                                   (int)MAX_CASCADES));
+  PackedInt64Array rd_sets;
+  while ((int)cascades.size() > count) {
+    free_textures(*cascades.back(), rd_sets);
+    cascades.pop_back();
+  }
+  queue_free_rd_sets(rd_sets);
+  while ((int)cascades.size() < count) {
+    cascades.push_back(std::unique_ptr<Cascade>(new Cascade));
+  }
+
+  for (int i = 0; i < count; ++i) {
+    Cascade &c = *cascades[i];
+    double size = cascade_patch_sizes.is_empty()
+                      ? 64.0
+                      : cascade_patch_sizes[i];
+    int res = cascade_resolutions.is_empty()
+                  ? 64
+                  : cascade_resolutions[std::min(
+                        i, (int)cascade_resolutions.size() - 1)];
+    int interval = cascade_update_intervals.is_empty()
+                       ? 1
+                       : cascade_update_intervals[std::min(
+                             i, (int)cascade_update_intervals.size() - 1)];
+    if (c.resolution != res) {
+      c.resolution = res;
+      c.resolution_dirty = true;
+    }
+    if (c.size != size) {
+      c.size = size;
+      c.spectrum_dirty = true;
+    }
+    c.update_interval = std::max(interval, 1);
+  }
+
+  // Bands: the largest patch takes the longest waves, and each boundary
+  // sits at CASCADE_BAND_FACTOR fundamentals of the next smaller patch
+  const double PI = 3.14159265358979323846;
+  std::vector<Cascade *> order;
+  for (std::unique_ptr<Cascade> &cascade : cascades) {
+    order.push_back(cascade.get());
+  }
+  std::stable_sort(order.begin(), order.end(),
+                   [](const Cascade *a, const Cascade *b) {
+                     return a->size > b->size;
+                   });
+  for (int j = 0; j < count; ++j) {
+    Cascade &c = *order[j];
+    double k_min = j == 0 ? 0.0 : CASCADE_BAND_FACTOR * 2.0 * PI / c.size;
+    double k_max = j + 1 < count
+                       ? CASCADE_BAND_FACTOR * 2.0 * PI / order[j + 1]->size
+                       : 0.0;
+    if (c.k_min != k_min || c.k_max != k_max) {
+      c.k_min = k_min;
+      c.k_max = k_max;
+      c.spectrum_dirty = true;
+    }
+  }
+  cascades_dirty = false;
+}
+
+void OceanWaveGenerator::init_cascade(Cascade &p_cascade, int p_index) {
+  const double PI = 3.14159265358979323846;
+  Cascade &c = p_cascade;
+  int resolution = c.resolution;
+  int total = resolution * resolution;
+
+  if (c.resolution_dirty) {
+    c.gaussian_noise.resize(total);
+    c.h0_k.resize(total);
+    int half_total = (resolution / 2 + 1) * resolution;
+    for (std::vector<float> *table :
+         {&c.h0_re, &c.h0_im, &c.h0_minus_re, &c.h0_minus_im, &c.dispersion,
+          &c.odd_kx, &c.odd_kz, &c.dir_x, &c.dir_z, &c.jacobian_xx,
+          &c.jacobian_zz, &c.jacobian_xz, &c.phase_re, &c.phase_im,
+          &c.rotation_re, &c.rotation_im}) {
+      table->assign(half_total, 0.0f);
+    }
+    for (int f = 0; f < MAP_COUNT; ++f) {
+      c.spectrum_re[f].resize(half_total);
+      c.spectrum_im[f].resize(half_total);
+      for (Frame &frame : c.frames) {
+        frame.maps[f].assign(total, 0.0f);
+      }
+    }
+    for (Frame &frame : c.frames) {
+      frame.resolution = resolution;
+    }
+    c.fft = nullptr;
+    c.resolution_dirty = false;
+    c.noise_dirty = true;
+  }
+  if (!c.fft)
+    c.fft = get_fft_plan(resolution);
+
+  if (c.noise_dirty) {
+    // Offset per cascade so overlapping patches don't repeat one pattern
+    std::mt19937 rng((uint32_t)(seed + p_index));
+    for (int i = 0; i < total; ++i) {
+      c.gaussian_noise[i] = gaussian_pair(rng);
+    }
+    c.noise_dirty = false;
+    c.spectrum_dirty = true;
+  }
 
-OceanWaveGenerator::~OceanWaveGenerator() {}
+  if (c.spectrum_dirty) {
+    // h0 = xi / sqrt(2) * sqrt(S(k) / 2) * dk, so that the height variance
+    // of h0(k) e^{iwt} + conj(h0(-k)) e^{-iwt} summed over k is sum S dk^2
+    double dk = 2.0 * PI / c.size;
+    for (int z = 0; z < resolution; ++z) {
+      for (int x = 0; x < resolution; ++x) {
+        int kx_idx = (x <= resolution / 2) ? x : x - resolution;
+        int kz_idx = (z <= resolution / 2) ? z : z - resolution;
+        double kx = kx_idx * dk;
+        double kz = kz_idx * dk;
+        double k_len = std::sqrt(kx * kx + kz * kz);
+        bool in_band =
+            k_len >= c.k_min && (c.k_max <= 0.0 || k_len < c.k_max);
+        double s = in_band ? evaluate_spectrum(kx, kz) : 0.0;
+        float amplitude = (float)(std::sqrt(s * 0.25) * dk);
+        c.h0_k[z * resolution + x] =
+            c.gaussian_noise[z * resolution + x] * amplitude;
+      }
+    }
+    const double G = 9.81;
+    int half = resolution / 2;
+    int stride = half + 1;
+    for (int z = 0; z < resolution; ++z) {
+      int mz = (resolution - z) % resolution;
+      int kz_idx = (z <= half) ? z : z - resolution;
+      for (int x = 0; x <= half; ++x) {
+        int mx = (resolution - x) % resolution;
+        int idx = z * stride + x;
+        std::complex<float> a = c.h0_k[z * resolution + x];
+        std::complex<float> b = std::conj(c.h0_k[mz * resolution + mx]);
+        c.h0_re[idx] = a.real();
+        c.h0_im[idx] = a.imag();
+        c.h0_minus_re[idx] = b.real();
+        c.h0_minus_im[idx] = b.imag();
 
-float OceanWaveGenerator::get_wave_height(float x, float z) {
-  // Bilinear interpolation from height_map
-  // Map world (x, z) to grid (u, v)
-  // Assume grid covers 0..size
+        double kx = x * dk;
+        double kz = kz_idx * dk;
+        double k_len = std::sqrt(kx * kx + kz * kz);
+        bool odd = k_len >= 0.0001 && x != half && kz_idx != half;
+        double w = std::sqrt(G * k_len);
+        if (loop_period > 0.0f) {
+          // Whole number of cycles per loop
+          double w0 = 2.0 * PI / loop_period;
+          w = std::round(w / w0) * w0;
+        }
+        c.dispersion[idx] = (float)w;
+        c.odd_kx[idx] = odd ? (float)kx : 0.0f;
+        c.odd_kz[idx] = odd ? (float)kz : 0.0f;
+        c.dir_x[idx] = odd ? (float)(kx / k_len) : 0.0f;
+        c.dir_z[idx] = odd ? (float)(kz / k_len) : 0.0f;
+        double inv_k = k_len >= 0.0001 ? 1.0 / k_len : 0.0;
+        c.jacobian_xx[idx] = (float)(kx * kx * inv_k);
+        c.jacobian_zz[idx] = (float)(kz * kz * inv_k);
+        c.jacobian_xz[idx] = (float)(kx * kz * inv_k);
+      }
+    }
+    // w(k) changed, so neither the phase nor the rotation table holds
+    c.phase_valid = false;
+    c.phase_step = -1.0;
+    c.spectrum_dirty = false;
+  }
 
-  double u = std::fmod(x, size);
-  double v = std::fmod(z, size);
-  if (u < 0)
-    u += size;
-  if (v < 0)
-    v += size;
+  for (Frame &frame : c.frames) {
+    frame.size = c.size;
+  }
+}
 
-  double grid_x = (u / size) * resolution;
-  double grid_z = (v / size) * resolution;
+void OceanWaveGenerator::set_spectrum_type(SpectrumType p_type) {
+  spectrum_type = p_type;
+  spectrum_dirty = true;
+}
 
-  int x0 = (int)grid_x % resolution;
-  int z0 = (int)grid_z % resolution;
-  int x1 = (x0 + 1) % resolution;
-  int z1 = (z0 + 1) % resolution;
+OceanWaveGenerator::SpectrumType OceanWaveGenerator::get_spectrum_type() const {
+  return spectrum_type;
+}
 
-  double frac_x = grid_x - (int)grid_x;
-  double frac_z = grid_z - (int)grid_z;
+void OceanWaveGenerator::set_resolution(int p_resolution) {
+  ERR_FAIL_COND_MSG(p_resolution < 4 ||
+                        (p_resolution & (p_resolution - 1)) != 0,
+                    "Resolution must be a power of two >= 4.");
+  if (cascade_resolutions.is_empty())
+    cascade_resolutions.push_back(p_resolution);
+  cascade_resolutions.set(0, p_resolution);
+  cascades_dirty = true;
+}
 
-  double h00 = height_map[z0 * resolution + x0];
-  double h10 = height_map[z0 * resolution + x1];
-  double h01 = height_map[z1 * resolution + x0];
-  double h11 = height_map[z1 * resolution + x1];
+int OceanWaveGenerator::get_resolution() const {
+  return cascade_resolutions.is_empty() ? 64 : cascade_resolutions[0];
+}
 
-  double h_interp = (1 - frac_x) * (1 - frac_z) * h00 +
-                    frac_x * (1 - frac_z) * h10 + (1 - frac_x) * frac_z * h01 +
-                    frac_x * frac_z * h11;
+void OceanWaveGenerator::set_patch_size(float p_size) {
+  ERR_FAIL_COND_MSG(p_size <= 0.0f, "Patch size must be positive.");
+  if (cascade_patch_sizes.is_empty())
+    cascade_patch_sizes.push_back(p_size);
+  cascade_patch_sizes.set(0, p_size);
+  cascades_dirty = true;
+}
 
-  // Scale height for visualization
-  return (float)(h_interp * 10.0);
+float OceanWaveGenerator::get_patch_size() const {
+  return cascade_patch_sizes.is_empty() ? 64.0f : cascade_patch_sizes[0];
 }
 
-// FFT Helpers
-unsigned int OceanWaveGenerator::reverse_bits(unsigned int num, int log2n) {
-  unsigned int reversed = 0;
-  for (int i = 0; i < log2n; ++i) {
-    if (num & (1 << i)) {
-      reversed |= 1 << (log2n - 1 - i);
-    }
+void OceanWaveGenerator::set_cascade_patch_sizes(
+    const PackedFloat32Array &p_sizes) {
+  ERR_FAIL_COND_MSG(p_sizes.is_empty() || p_sizes.size() > MAX_CASCADES,
+                    "Cascade count must be between 1 and 4.");
+  for (int i = 0; i < p_sizes.size(); ++i) {
+    ERR_FAIL_COND_MSG(p_sizes[i] <= 0.0f, "Patch size must be positive.");
   }
-  return reversed;
+  cascade_patch_sizes = p_sizes;
+  cascades_dirty = true;
 }
 
-void OceanWaveGenerator::bit_reverse_copy(
-    const std::vector<std::complex<double>> &src,
-    std::vector<std::complex<double>> &dst, int n) {
-  int log2n = 0;
-  while ((1 << log2n) < n)
-    log2n++;
+PackedFloat32Array OceanWaveGenerator::get_cascade_patch_sizes() const {
+  return cascade_patch_sizes;
+}
 
-  for (int i = 0; i < n; ++i) {
-    dst[reverse_bits(i, log2n)] = src[i];
+void OceanWaveGenerator::set_cascade_resolutions(
+    const PackedInt32Array &p_resolutions) {
+  for (int i = 0; i < p_resolutions.size(); ++i) {
+    int r = p_resolutions[i];
+    ERR_FAIL_COND_MSG(r < 4 || (r & (r - 1)) != 0,
+                      "Resolution must be a power of two >= 4.");
   }
+  cascade_resolutions = p_resolutions;
+  cascades_dirty = true;
 }
 
-void OceanWaveGenerator::perform_fft(std::vector<std::complex<double>> &data,
-                                     int n) {
-  // Basic Cooley-Tukey
-  int log2n = 0;
-  while ((1 << log2n) < n)
-    log2n++;
-
-  std::vector<std::complex<double>> temp(n);
-  bit_reverse_copy(data, temp, n);
-  data = temp;
+PackedInt32Array OceanWaveGenerator::get_cascade_resolutions() const {
+  return cascade_resolutions;
+}
 
-  const double PI = 3.14159265358979323846;
-  for (int s = 1; s <= log2n; ++s) {
-    int m = 1 << s;
-    int m2 = m >> 1;
-    std::complex<double> wm =
-        std::exp(std::complex<double>(0, -2.0 * PI / m)); // Forward FFT uses -i
-
-    for (int k = 0; k < n; k += m) {
-      std::complex<double> w = 1.0;
-      for (int j = 0; j < m2; ++j) {
-        std::complex<double> t = w * data[k + j + m2];
-        std::complex<double> u = data[k + j];
-        data[k + j] = u + t;
-        data[k + j + m2] = u - t;
-        w *= wm;
-      }
-    }
-  }
+void OceanWaveGenerator::set_cascade_update_intervals(
+    const PackedInt32Array &p_intervals) {
+  cascade_update_intervals = p_intervals;
+  cascades_dirty = true;
 }
 
-// Helper to get consistent test spectrum
-std::complex<double> get_test_h0(int kx, int kz, int n) {
-  // Aliasing handling: kx in [0, n/2] -> kx, [n/2+1, n-1] -> kx - n
-  int real_kx = (kx <= n / 2) ? kx : kx - n;
-  int real_kz = (kz <= n / 2) ? kz : kz - n;
+PackedInt32Array OceanWaveGenerator::get_cascade_update_intervals() const {
+  return cascade_update_intervals;
+}
 
-  // Simple reproducible test case: 2 main waves
-  if (real_kx == 1 && real_kz == 1)
-    return std::complex<double>(10.0, 0.0);
-  if (real_kx == 2 && real_kz == 0)
-    return std::complex<double>(5.0, 5.0);
-  return std::complex<double>(0.0, 0.0);
+void OceanWaveGenerator::set_simulation_rate(float p_rate) {
+  simulation_rate = std::max(p_rate, 0.0f);
 }
 
-void OceanWaveGenerator::_process(double delta) {
-  // Debug: Print every frame? No, spam.
-  // printf/print?
-  static double print_timer = 0.0;
-  print_timer += delta;
-  if (print_timer > 1.0) {
-    UtilityFunctions::print("CPP Ocean Update. Time: ", time);
-    print_timer = 0.0;
-  }
+float OceanWaveGenerator::get_simulation_rate() const {
+  return simulation_rate;
+}
 
-  if (Engine::get_singleton()->is_editor_hint())
+void OceanWaveGenerator::set_fft_backend(FFTBackend p_backend) {
+  if (p_backend == fft_backend)
     return;
+  fft_backend = p_backend;
+  fft_dirty = true;
+}
 
-  time += delta;
+OceanWaveGenerator::FFTBackend OceanWaveGenerator::get_fft_backend() const {
+  return fft_backend;
+}
 
-  const double PI = 3.14159265358979323846;
-  const double G = 9.81;
-  double L = size; // Physical size (e.g. 64 meters)
+String OceanWaveGenerator::get_active_fft_backend(int p_cascade) const {
+  ERR_FAIL_INDEX_V(p_cascade, (int)cascades.size(), String());
+  const Cascade &c = *cascades[p_cascade];
+  return c.fft ? String(c.fft->get_name()) : String();
+}
+
+int OceanWaveGenerator::get_cascade_count() const {
+  return std::max(1, std::min((int)cascade_patch_sizes.size(),
+                              (int)MAX_CASCADES));
+}
 
-  // 1. Update Phase and H(k, t)
-  for (int z = 0; z < resolution; ++z) {
-    for (int x = 0; x < resolution; ++x) {
-      int kx_idx = (x <= resolution / 2) ? x : x - resolution;
-      int kz_idx = (z <= resolution / 2) ? z : z - resolution;
+void OceanWaveGenerator::set_wind_speed(float p_speed) {
+  wind_speed = p_speed;
+  spectrum_dirty = true;
+}
 
-      double kx = 2.0 * PI * kx_idx / L;
-      double kz = 2.0 * PI * kz_idx / L;
-      double k_len = std::sqrt(kx * kx + kz * kz);
+float OceanWaveGenerator::get_wind_speed() const { return wind_speed; }
 
-      if (k_len < 0.0001) {
-        h_k_t[z * resolution + x] = std::complex<double>(0, 0);
-        continue;
-      }
+void OceanWaveGenerator::set_wind_direction(const Vector2 &p_direction) {
+  wind_direction = p_direction;
+  spectrum_dirty = true;
+}
 
-      // Dispersion: w = sqrt(g * k)
-      double w = std::sqrt(G * k_len);
-      double phase = w * time;
+Vector2 OceanWaveGenerator::get_wind_direction() const {
+  return wind_direction;
+}
 
-      std::complex<double> h0 = h0_k[z * resolution + x];
+void OceanWaveGenerator::set_fetch(float p_fetch) {
+  fetch = p_fetch;
+  spectrum_dirty = true;
+}
 
-      // Euler: exp(i * phase)
-      std::complex<double> exp_phase = std::exp(std::complex<double>(0, phase));
+float OceanWaveGenerator::get_fetch() const { return fetch; }
 
-      h_k_t[z * resolution + x] = h0 * exp_phase;
-    }
-  }
+void OceanWaveGenerator::set_peak_enhancement(float p_gamma) {
+  peak_enhancement = p_gamma;
+  spectrum_dirty = true;
+}
 
-  // IFFT
-  // 1. Row FFT
-  std::vector<std::complex<double>> row_data(resolution);
-  for (int y = 0; y < resolution; ++y) {
-    for (int x = 0; x < resolution; ++x) {
-      row_data[x] = h_k_t[y * resolution + x];
-    }
-    perform_fft(row_data, resolution);
-    for (int x = 0; x < resolution; ++x) {
-      h_k_t[y * resolution + x] = row_data[x];
-    }
-  }
+float OceanWaveGenerator::get_peak_enhancement() const {
+  return peak_enhancement;
+}
 
-  // 2. Col FFT
-  std::vector<std::complex<double>> col_data(resolution);
-  for (int x = 0; x < resolution; ++x) {
-    for (int y = 0; y < resolution; ++y) {
-      col_data[y] = h_k_t[y * resolution + x];
-    }
-    perform_fft(col_data, resolution);
-    for (int y = 0; y < resolution; ++y) {
-      // Sign flip for IFFT usually handled by conjugate or standard alg,
-      // here our perform_fft is forward. For IFFT we can reverse or swap.
-      // Simplified: Just use the output magnitude/real scaling for now.
-      // A basic property of FFT/IFFT difference is scaling 1/N.
-      // We will just scale output to look good.
-      height_map[y * resolution + x] = col_data[y].real() *
-                                       (1.0 / (resolution * resolution)) *
-                                       100.0; // Arbitrary scale for visibility
+void OceanWaveGenerator::set_phillips_amplitude(float p_amplitude) {
+  phillips_amplitude = p_amplitude;
+  spectrum_dirty = true;
+}
+
+float OceanWaveGenerator::get_phillips_amplitude() const {
+  return phillips_amplitude;
+}
+
+void OceanWaveGenerator::set_seed(int p_seed) {
+  seed = p_seed;
+  noise_dirty = true;
+}
+
+int OceanWaveGenerator::get_seed() const { return seed; }
+
+void OceanWaveGenerator::set_choppiness(float p_choppiness) {
+  choppiness = p_choppiness;
+  // Baked into the cached displacement
+  if (loop_period > 0.0f)
+    loop_dirty = true;
+}
+
+float OceanWaveGenerator::get_choppiness() const { return choppiness; }
+
+void OceanWaveGenerator::set_loop_period(float p_period) {
+  ERR_FAIL_COND_MSG(p_period < 0.0f, "Loop period can't be negative.");
+  loop_period = p_period;
+  spectrum_dirty = true;
+}
+
+float OceanWaveGenerator::get_loop_period() const { return loop_period; }
+
+void OceanWaveGenerator::set_loop_frame_count(int p_count) {
+  ERR_FAIL_COND_MSG(p_count < 2, "A loop needs at least two frames.");
+  loop_frame_count = p_count;
+  loop_dirty = true;
+}
+
+int OceanWaveGenerator::get_loop_frame_count() const {
+  return loop_frame_count;
+}
+
+void OceanWaveGenerator::set_loop_cache_path(const String &p_path) {
+  loop_cache_path = p_path;
+  loop_dirty = true;
+}
+
+String OceanWaveGenerator::get_loop_cache_path() const {
+  return loop_cache_path;
+}
+
+void OceanWaveGenerator::set_export_textures(bool p_enabled) {
+  export_textures = p_enabled;
+  if (!export_textures) {
+    PackedInt64Array rd_sets;
+    for (std::unique_ptr<Cascade> &cascade : cascades) {
+      free_textures(*cascade, rd_sets);
     }
+    queue_free_rd_sets(rd_sets);
   }
 }
 
-// ... (get_wave_height, helpers remain same) ...
+bool OceanWaveGenerator::get_export_textures() const {
+  return export_textures;
+}
 
-void OceanWaveGenerator::init_spectrum() {
-  int total = resolution * resolution;
-  h0_k.resize(total);
-  h_k_t.resize(total);
-  height_map.resize(total);
+Ref<Texture2D> OceanWaveGenerator::get_displacement_texture(int p_cascade) const {
+  ERR_FAIL_INDEX_V(p_cascade, (int)cascades.size(), Ref<Texture2D>());
+  return cascades[p_cascade]->displacement_texture;
+}
+
+Ref<Texture2D> OceanWaveGenerator::get_normal_texture(int p_cascade) const {
+  ERR_FAIL_INDEX_V(p_cascade, (int)cascades.size(), Ref<Texture2D>());
+  return cascades[p_cascade]->normal_texture;
+}
+
+Ref<Texture2D> OceanWaveGenerator::get_foam_texture(int p_cascade) const {
+  ERR_FAIL_INDEX_V(p_cascade, (int)cascades.size(), Ref<Texture2D>());
+  return cascades[p_cascade]->foam_texture;
+}
+
+void OceanWaveGenerator::set_foam_threshold(float p_threshold) {
+  foam_threshold = p_threshold;
+}
+
+float OceanWaveGenerator::get_foam_threshold() const { return foam_threshold; }
+
+void OceanWaveGenerator::set_foam_decay(float p_decay) {
+  ERR_FAIL_COND_MSG(p_decay < 0.0f, "Foam decay can't be negative.");
+  foam_decay = p_decay;
+}
+
+float OceanWaveGenerator::get_foam_decay() const { return foam_decay; }
+
+PackedFloat32Array OceanWaveGenerator::get_foam_map(int p_cascade) {
+  PackedFloat32Array result;
+  ERR_FAIL_INDEX_V(p_cascade, (int)cascades.size(), result);
+  sync_loop_frames();
+  const Cascade &c = *cascades[p_cascade];
+  const Frame &frame =
+      c.frames[c.front_frame.load(std::memory_order_acquire)];
+  result.resize(frame.foam.size());
+  std::copy(frame.foam.begin(), frame.foam.end(), result.ptrw());
+  return result;
+}
 
-  for (int z = 0; z < resolution; ++z) {
-    for (int x = 0; x < resolution; ++x) {
-      h0_k[z * resolution + x] = get_test_h0(x, z, resolution);
+PackedVector3Array OceanWaveGenerator::get_foam_spawn_points(
+    const Vector3 &p_center, float p_min_coverage, int p_max_points,
+    int p_cascade) {
+  PackedVector3Array points;
+  ERR_FAIL_INDEX_V(p_cascade, (int)cascades.size(), points);
+  sync_loop_frames();
+  const Cascade &c = *cascades[p_cascade];
+  const Frame &frame =
+      c.frames[c.front_frame.load(std::memory_order_acquire)];
+  int n = frame.resolution;
+  if (n == 0 || (int)frame.foam.size() != n * n || p_max_points <= 0)
+    return points;
+
+  int candidates = 0;
+  for (float coverage : frame.foam) {
+    candidates += coverage >= p_min_coverage;
+  }
+  if (candidates == 0)
+    return points;
+
+  // Keep every stride-th candidate so the points cover the whole patch
+  int stride = (candidates + p_max_points - 1) / p_max_points;
+  points.resize(std::min(candidates / stride + 1, p_max_points));
+  Vector3 *out = points.ptrw();
+  int count = 0;
+  int seen = 0;
+  double cell = frame.size / n;
+  for (int z = 0; z < n && count < (int)points.size(); ++z) {
+    for (int x = 0; x < n && count < (int)points.size(); ++x) {
+      int i = z * n + x;
+      if (frame.foam[i] < p_min_coverage || seen++ % stride != 0)
+        continue;
+      double px = x * cell + frame.maps[MAP_DISPLACEMENT_X][i];
+      double pz = z * cell + frame.maps[MAP_DISPLACEMENT_Z][i];
+      // Nearest repeat of the patch to p_center
+      px += frame.size * std::round((p_center.x - px) / frame.size);
+      pz += frame.size * std::round((p_center.z - pz) / frame.size);
+      out[count++] = Vector3((float)px, frame.maps[MAP_HEIGHT][i], (float)pz);
     }
   }
+  points.resize(count);
+  return points;
 }
 
 // --- BuoyancyProbe3D ---
@@ -247,6 +1964,34 @@ void BuoyancyProbe3D::_bind_methods() {
                        &BuoyancyProbe3D::get_ocean_node);
   ADD_PROPERTY(PropertyInfo(Variant::NODE_PATH, "ocean_node"), "set_ocean_node",
                "get_ocean_node");
+
+  ClassDB::bind_method(D_METHOD("set_probe_points", "points"),
+                       &BuoyancyProbe3D::set_probe_points);
+  ClassDB::bind_method(D_METHOD("get_probe_points"),
+                       &BuoyancyProbe3D::get_probe_points);
+  ADD_PROPERTY(PropertyInfo(Variant::PACKED_VECTOR3_ARRAY, "probe_points"),
+               "set_probe_points", "get_probe_points");
+
+  ClassDB::bind_method(D_METHOD("set_probe_volumes", "volumes"),
+                       &BuoyancyProbe3D::set_probe_volumes);
+  ClassDB::bind_method(D_METHOD("get_probe_volumes"),
+                       &BuoyancyProbe3D::get_probe_volumes);
+  ADD_PROPERTY(PropertyInfo(Variant::PACKED_FLOAT32_ARRAY, "probe_volumes"),
+               "set_probe_volumes", "get_probe_volumes");
+
+  ClassDB::bind_method(D_METHOD("set_probe_drags", "drags"),
+                       &BuoyancyProbe3D::set_probe_drags);
+  ClassDB::bind_method(D_METHOD("get_probe_drags"),
+                       &BuoyancyProbe3D::get_probe_drags);
+  ADD_PROPERTY(PropertyInfo(Variant::PACKED_FLOAT32_ARRAY, "probe_drags"),
+               "set_probe_drags", "get_probe_drags");
+
+  ClassDB::bind_method(D_METHOD("set_substeps", "substeps"),
+                       &BuoyancyProbe3D::set_substeps);
+  ClassDB::bind_method(D_METHOD("get_substeps"), &BuoyancyProbe3D::get_substeps);
+  ADD_PROPERTY(
+      PropertyInfo(Variant::INT, "substeps", PROPERTY_HINT_RANGE, "1,16,1"),
+      "set_substeps", "get_substeps");
 }
 
 BuoyancyProbe3D::BuoyancyProbe3D() {
@@ -265,23 +2010,270 @@ void BuoyancyProbe3D::_ready() {
   }
 }
 
-void BuoyancyProbe3D::_physics_process(double delta) {
-  if (ocean_node) {
-    Vector3 global_pos = get_global_position();
-    float wave_height =
-        ocean_node->get_wave_height((float)global_pos.x, (float)global_pos.z);
+// Entry p_index of p_values, the last one past its end, 1 when empty
+static float get_point_scale(const PackedFloat32Array &p_values, int p_index) {
+  if (p_values.is_empty())
+    return 1.0f;
+  return p_values[std::min(p_index, (int)p_values.size() - 1)];
+}
+
+// Result of integrate_buoyant_point over one physics tick
+struct BuoyantStep {
+  float vertical_velocity = 0.0f; // at the end of the tick
+  float horizontal_decay = 1.0f;  // factor on the horizontal velocity
+  bool wet = false;               // under water for part of the tick
+};
+
+// Moves one sample point through p_delta under gravity and, while under
+// water, buoyancy and drag, all per unit mass:
+//
+//   y'' = k (h + rate t - y) - c y' - g,   c = drag * depth
+//
+// Each sub-step is solved in closed form for the spring on a surface
+// moving at p_height_rate, so stiff springs stay stable at any tick rate;
+// sub-steps only track the depth-dependent drag and surface crossings.
+// The returned velocity is what the body should reach, not a force.
+static BuoyantStep integrate_buoyant_point(float p_y, float p_velocity,
+                                           float p_height,
+                                           float p_height_rate,
+                                           float p_stiffness, float p_drag,
+                                           float p_gravity, double p_delta,
+                                           int p_substeps) {
+  BuoyantStep step;
+  double y = p_y;
+  double v = p_velocity;
+  double tau = p_delta / p_substeps;
+  for (int s = 0; s < p_substeps; ++s) {
+    double height = p_height + p_height_rate * tau * s;
+    double depth = height - y;
+    if (depth <= 0.0 || p_stiffness <= 0.0f) {
+      y += v * tau - 0.5 * p_gravity * tau * tau;
+      v -= p_gravity * tau;
+      continue;
+    }
+    step.wet = true;
+    double w2 = p_stiffness;
+    double beta = 0.5 * p_drag * depth;
+    step.horizontal_decay *= (float)std::exp(-2.0 * beta * tau);
+    // Offset from the moving equilibrium, which trails the surface by
+    // the gravity sag and the drag lag
+    double equilibrium =
+        height - (p_gravity + 2.0 * beta * p_height_rate) / w2;
+    double x0 = y - equilibrium;
+    double u0 = v - p_height_rate;
+    // Under-, over- and critically damped cases share
+    // x = e^(-beta t) (x0 C + (u0 + beta x0) S) with C' = -wd2 S, S' = C
+    double wd2 = w2 - beta * beta;
+    double c, sn;
+    if (wd2 > 1e-6) {
+      double wd = std::sqrt(wd2);
+      c = std::cos(wd * tau);
+      sn = std::sin(wd * tau) / wd;
+    } else if (wd2 < -1e-6) {
+      double mu = std::sqrt(-wd2);
+      c = std::cosh(mu * tau);
+      sn = std::sinh(mu * tau) / mu;
+    } else {
+      c = 1.0;
+      sn = tau;
+    }
+    double decay = std::exp(-beta * tau);
+    double x = decay * (x0 * c + (u0 + beta * x0) * sn);
+    double u = decay * (u0 * c - (beta * u0 + w2 * x0) * sn);
+    y = equilibrium + p_height_rate * tau + x;
+    v = p_height_rate + u;
+  }
+  step.vertical_velocity = (float)v;
+  return step;
+}
 
-    if (global_pos.y < wave_height) {
-      float depth = wave_height - (float)global_pos.y;
-      Vector3 up_force = Vector3(0, 1, 0) * (buoyancy_force * depth);
+// Water height change since the last tick, 0 without a previous sample
+static float get_height_rate(float p_height, float p_previous, double p_delta) {
+  if (std::isnan(p_previous) || p_delta <= 0.0)
+    return 0.0f;
+  return (float)((p_height - p_previous) / p_delta);
+}
 
-      // Apply drag
-      Vector3 velocity = get_linear_velocity();
-      Vector3 drag_force = -velocity * water_drag * depth;
+// One body's contact with the water in a tick: sums over its points under
+// water and above it, for the event positions and velocities
+struct WaterContact {
+  int wet = 0;
+  int dry = 0;
+  Vector3 wet_position;
+  Vector3 wet_velocity;
+  Vector3 dry_position;
+  Vector3 dry_velocity;
 
-      apply_central_force(up_force + drag_force);
+  void add(const Vector3 &p_point, float p_height, const Vector3 &p_velocity) {
+    Vector3 surface(p_point.x, p_height, p_point.z);
+    if (p_height > p_point.y) {
+      wet++;
+      wet_position += surface;
+      wet_velocity += p_velocity;
+    } else {
+      dry++;
+      dry_position += surface;
+      dry_velocity += p_velocity;
     }
   }
+};
+
+// A capsized body counts as righted again only once its up axis is this
+// far above the horizon, so rolling about it does not repeat events
+static const float CAPSIZE_RIGHTED = 0.25f;
+
+// Moves r_state to this tick's contact and records an event for every
+// transition
+static void update_water_state(uint8_t &r_state, const WaterContact &p_contact,
+                               const Basis &p_basis, uint64_t p_body,
+                               uint64_t p_object) {
+  uint8_t state = 0;
+  if (p_contact.wet > 0) {
+    state |= BuoyancySystem::WATER_STATE_WET;
+    if (p_contact.dry == 0)
+      state |= BuoyancySystem::WATER_STATE_SUBMERGED;
+    float up = (float)p_basis.get_column(1).y;
+    if (up < ((r_state & BuoyancySystem::WATER_STATE_CAPSIZED)
+                  ? CAPSIZE_RIGHTED
+                  : 0.0f))
+      state |= BuoyancySystem::WATER_STATE_CAPSIZED;
+  }
+  uint8_t entered = state & ~r_state;
+  bool surfaced = (r_state & BuoyancySystem::WATER_STATE_SUBMERGED) &&
+                  !(state & BuoyancySystem::WATER_STATE_SUBMERGED);
+  r_state = state;
+  if (!entered && !surfaced)
+    return;
+
+  BuoyancySystem::WaterEventRecord event;
+  event.body = p_body;
+  event.object = p_object;
+  if (p_contact.wet > 0) {
+    event.position = p_contact.wet_position / (float)p_contact.wet;
+    event.velocity = p_contact.wet_velocity / (float)p_contact.wet;
+  }
+  if (entered & BuoyancySystem::WATER_STATE_WET) {
+    event.type = BuoyancySystem::EVENT_ENTERED_WATER;
+    BuoyancySystem::push_event(event);
+  }
+  if (entered & BuoyancySystem::WATER_STATE_SUBMERGED) {
+    event.type = BuoyancySystem::EVENT_SUBMERGED;
+    BuoyancySystem::push_event(event);
+  }
+  if (entered & BuoyancySystem::WATER_STATE_CAPSIZED) {
+    event.type = BuoyancySystem::EVENT_CAPSIZED;
+    BuoyancySystem::push_event(event);
+  }
+  if (surfaced && p_contact.dry > 0) {
+    event.type = BuoyancySystem::EVENT_SURFACED;
+    event.position = p_contact.dry_position / (float)p_contact.dry;
+    event.velocity = p_contact.dry_velocity / (float)p_contact.dry;
+    BuoyancySystem::push_event(event);
+  }
+}
+
+void BuoyancyProbe3D::_notification(int p_what) {
+  if (p_what == NOTIFICATION_ENTER_TREE) {
+    BuoyancySystem::register_probe(this);
+  } else if (p_what == NOTIFICATION_EXIT_TREE) {
+    BuoyancySystem::unregister_probe(this);
+  }
+}
+
+int BuoyancyProbe3D::get_sample_count() const {
+  return probe_points.is_empty() ? 1 : (int)probe_points.size();
+}
+
+void BuoyancyProbe3D::get_sample_points(const Transform3D &p_transform,
+                                        Vector3 *r_points) const {
+  if (probe_points.is_empty()) {
+    r_points[0] = p_transform.origin;
+    return;
+  }
+  for (int i = 0; i < (int)probe_points.size(); ++i) {
+    r_points[i] = p_transform.xform(probe_points[i]);
+  }
+}
+
+void BuoyancyProbe3D::apply_samples(const Transform3D &p_transform,
+                                    const Vector3 *p_points,
+                                    const float *p_heights, double p_delta) {
+  int count = get_sample_count();
+  if ((int)previous_heights.size() != count)
+    previous_heights.assign(count, NAN);
+  if (p_delta <= 0.0)
+    return;
+
+  // Point forces are summed into one force and one torque about the
+  // centre of mass, so the body pitches and rolls with the surface
+  PhysicsDirectBodyState3D *state =
+      PhysicsServer3D::get_singleton()->body_get_direct_state(get_rid());
+  Vector3 center = p_transform.origin;
+  float gravity = 9.8f;
+  if (state) {
+    center += state->get_center_of_mass();
+    gravity = -(float)state->get_total_gravity().y;
+  }
+  Vector3 linear_velocity = get_linear_velocity();
+  Vector3 angular_velocity = get_angular_velocity();
+  // Each point carries an equal share of the mass; buoyancy_force and
+  // water_drag are forces, so per unit mass they scale with the count
+  float point_mass = std::max(get_mass(), 1e-4f) / count;
+
+  Vector3 force;
+  Vector3 torque;
+  bool submerged = false;
+  WaterContact contact;
+  for (int i = 0; i < count; ++i) {
+    Vector3 arm = p_points[i] - center;
+    Vector3 velocity = linear_velocity + angular_velocity.cross(arm);
+    contact.add(p_points[i], p_heights[i], velocity);
+    BuoyantStep step = integrate_buoyant_point(
+        (float)p_points[i].y, (float)velocity.y, p_heights[i],
+        get_height_rate(p_heights[i], previous_heights[i], p_delta),
+        buoyancy_force * get_point_scale(probe_volumes, i) / point_mass,
+        water_drag * get_point_scale(probe_drags, i) / point_mass,
+        gravity, p_delta, substeps);
+    previous_heights[i] = p_heights[i];
+    if (!step.wet)
+      continue;
+    submerged = true;
+    // The force that brings the point to the integrated velocity in one
+    // engine step, less the gravity the engine adds itself
+    Vector3 point_force =
+        (Vector3(velocity.x * (step.horizontal_decay - 1.0f),
+                 step.vertical_velocity - (float)velocity.y,
+                 velocity.z * (step.horizontal_decay - 1.0f)) /
+             (float)p_delta +
+         Vector3(0, gravity, 0)) *
+        point_mass;
+    force += point_force;
+    torque += arm.cross(point_force);
+  }
+  update_water_state(water_state, contact, p_transform.basis,
+                     get_rid().get_id(), get_instance_id());
+  if (!submerged)
+    return;
+  apply_central_force(force);
+  apply_torque(torque);
+}
+
+void BuoyancyProbe3D::_physics_process(double delta) {
+  // READY re-enables physics processing after register_probe turned it
+  // off; the active system already applies this probe's samples
+  if (BuoyancySystem::get_active_system() || !ocean_node)
+    return;
+
+  Transform3D transform = get_global_transform();
+  int count = get_sample_count();
+  sample_points.resize(count);
+  sample_heights.resize(count);
+  get_sample_points(transform, sample_points.data());
+  ocean_node->sample_batch(sample_points.data(), count,
+                           OceanWaveGenerator::SAMPLE_BILINEAR,
+                           sample_heights.data(), nullptr);
+  apply_samples(transform, sample_points.data(), sample_heights.data(),
+                delta);
 }
 
 void BuoyancyProbe3D::set_buoyancy_force(float p_force) {
@@ -303,3 +2295,426 @@ void BuoyancyProbe3D::set_ocean_node(const NodePath &p_path) {
 }
 
 NodePath BuoyancyProbe3D::get_ocean_node() const { return ocean_node_path; }
+
+void BuoyancyProbe3D::set_probe_points(const PackedVector3Array &p_points) {
+  probe_points = p_points;
+}
+
+PackedVector3Array BuoyancyProbe3D::get_probe_points() const {
+  return probe_points;
+}
+
+void BuoyancyProbe3D::set_probe_volumes(const PackedFloat32Array &p_volumes) {
+  probe_volumes = p_volumes;
+}
+
+PackedFloat32Array BuoyancyProbe3D::get_probe_volumes() const {
+  return probe_volumes;
+}
+
+void BuoyancyProbe3D::set_probe_drags(const PackedFloat32Array &p_drags) {
+  probe_drags = p_drags;
+}
+
+PackedFloat32Array BuoyancyProbe3D::get_probe_drags() const {
+  return probe_drags;
+}
+
+void BuoyancyProbe3D::set_substeps(int p_substeps) {
+  substeps = std::max(p_substeps, 1);
+}
+
+int BuoyancyProbe3D::get_substeps() const { return substeps; }
+
+std::vector<BuoyancyProbe3D *> BuoyancySystem::probes;
+std::vector<BuoyancySystem *> BuoyancySystem::systems;
+BuoyancySystem *BuoyancySystem::active_system = nullptr;
+std::vector<BuoyancySystem::WaterEventRecord> BuoyancySystem::events;
+int BuoyancySystem::event_head = 0;
+int BuoyancySystem::event_count = 0;
+
+void BuoyancySystem::_bind_methods() {
+  ClassDB::bind_method(D_METHOD("get_probe_count"),
+                       &BuoyancySystem::get_probe_count);
+
+  ClassDB::bind_method(D_METHOD("add_body", "body", "local_points", "mass"),
+                       &BuoyancySystem::add_body);
+  ClassDB::bind_method(D_METHOD("remove_body", "body"),
+                       &BuoyancySystem::remove_body);
+  ClassDB::bind_method(D_METHOD("has_body", "body"),
+                       &BuoyancySystem::has_body);
+  ClassDB::bind_method(D_METHOD("get_body_count"),
+                       &BuoyancySystem::get_body_count);
+
+  ClassDB::bind_method(D_METHOD("drain_events"),
+                       &BuoyancySystem::drain_events);
+  ClassDB::bind_method(D_METHOD("get_pending_event_count"),
+                       &BuoyancySystem::get_pending_event_count);
+
+  BIND_ENUM_CONSTANT(EVENT_ENTERED_WATER);
+  BIND_ENUM_CONSTANT(EVENT_SUBMERGED);
+  BIND_ENUM_CONSTANT(EVENT_CAPSIZED);
+  BIND_ENUM_CONSTANT(EVENT_SURFACED);
+
+  ClassDB::bind_method(D_METHOD("set_debris_buoyancy", "buoyancy"),
+                       &BuoyancySystem::set_debris_buoyancy);
+  ClassDB::bind_method(D_METHOD("get_debris_buoyancy"),
+                       &BuoyancySystem::get_debris_buoyancy);
+  ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "debris_buoyancy"),
+               "set_debris_buoyancy", "get_debris_buoyancy");
+
+  ClassDB::bind_method(D_METHOD("set_debris_drag", "drag"),
+                       &BuoyancySystem::set_debris_drag);
+  ClassDB::bind_method(D_METHOD("get_debris_drag"),
+                       &BuoyancySystem::get_debris_drag);
+  ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "debris_drag"), "set_debris_drag",
+               "get_debris_drag");
+
+  ClassDB::bind_method(D_METHOD("set_debris_substeps", "substeps"),
+                       &BuoyancySystem::set_debris_substeps);
+  ClassDB::bind_method(D_METHOD("get_debris_substeps"),
+                       &BuoyancySystem::get_debris_substeps);
+  ADD_PROPERTY(PropertyInfo(Variant::INT, "debris_substeps",
+                            PROPERTY_HINT_RANGE, "1,16,1"),
+               "set_debris_substeps", "get_debris_substeps");
+
+  ClassDB::bind_method(D_METHOD("set_ocean_node", "path"),
+                       &BuoyancySystem::set_ocean_node);
+  ClassDB::bind_method(D_METHOD("get_ocean_node"),
+                       &BuoyancySystem::get_ocean_node);
+  ADD_PROPERTY(PropertyInfo(Variant::NODE_PATH, "ocean_node"), "set_ocean_node",
+               "get_ocean_node");
+}
+
+BuoyancySystem::BuoyancySystem() { set_physics_process(true); }
+
+BuoyancySystem::~BuoyancySystem() { leave_systems(); }
+
+void BuoyancySystem::leave_systems() {
+  std::vector<BuoyancySystem *>::iterator it =
+      std::find(systems.begin(), systems.end(), this);
+  if (it == systems.end())
+    return;
+  systems.erase(it);
+  if (active_system != this)
+    return;
+  // The next system in tree order takes over the probes
+  active_system = systems.empty() ? nullptr : systems.front();
+  if (!active_system)
+    set_probes_processing(true);
+}
+
+void BuoyancySystem::_notification(int p_what) {
+  if (p_what == NOTIFICATION_READY) {
+    if (!ocean_node_path.is_empty()) {
+      ocean_node = Object::cast_to<OceanWaveGenerator>(
+          get_node<godot::Node>(ocean_node_path));
+    }
+  } else if (p_what == NOTIFICATION_ENTER_TREE) {
+    if (Engine::get_singleton()->is_editor_hint())
+      return;
+    systems.push_back(this);
+    if (!active_system) {
+      active_system = this;
+      set_probes_processing(false);
+    }
+  } else if (p_what == NOTIFICATION_EXIT_TREE) {
+    leave_systems();
+  }
+}
+
+void BuoyancySystem::set_probes_processing(bool p_enabled) {
+  for (BuoyancyProbe3D *probe : probes) {
+    probe->set_physics_process(p_enabled);
+  }
+}
+
+void BuoyancySystem::register_probe(BuoyancyProbe3D *p_probe) {
+  ERR_FAIL_COND(p_probe->system_index >= 0);
+  p_probe->system_index = (int)probes.size();
+  probes.push_back(p_probe);
+  if (active_system)
+    p_probe->set_physics_process(false);
+}
+
+void BuoyancySystem::unregister_probe(BuoyancyProbe3D *p_probe) {
+  int index = p_probe->system_index;
+  ERR_FAIL_INDEX(index, (int)probes.size());
+  // Swap with the last entry so removal stays O(1)
+  probes[index] = probes.back();
+  probes[index]->system_index = index;
+  probes.pop_back();
+  p_probe->system_index = -1;
+  p_probe->set_physics_process(true);
+}
+
+void BuoyancySystem::_physics_process(double delta) {
+  if (active_system == this)
+    process_probes(delta);
+  process_bodies(delta);
+}
+
+void BuoyancySystem::process_probes(double p_delta) {
+  if (probes.empty())
+    return;
+
+  // 1. Gather transforms and sample points into flat arrays, grouped by
+  //    ocean so that each ocean's points are contiguous
+  int probe_count = (int)probes.size();
+  transforms.resize(probe_count);
+  oceans.resize(probe_count);
+  order.resize(probe_count);
+  point_offsets.resize(probe_count + 1);
+  for (int i = 0; i < probe_count; ++i) {
+    BuoyancyProbe3D *probe = probes[i];
+    transforms[i] = probe->get_global_transform();
+    oceans[i] = probe->ocean_node ? probe->ocean_node : ocean_node;
+    order[i] = i;
+  }
+  std::stable_sort(order.begin(), order.end(), [this](int p_a, int p_b) {
+    return std::less<OceanWaveGenerator *>()(oceans[p_a], oceans[p_b]);
+  });
+  int total = 0;
+  for (int slot = 0; slot < probe_count; ++slot) {
+    point_offsets[slot] = total;
+    total += probes[order[slot]]->get_sample_count();
+  }
+  point_offsets[probe_count] = total;
+  points.resize(total);
+  heights.resize(total);
+  for (int slot = 0; slot < probe_count; ++slot) {
+    int i = order[slot];
+    probes[i]->get_sample_points(transforms[i], &points[point_offsets[slot]]);
+  }
+
+  // 2. One batched query per ocean; scenes usually have a single ocean,
+  //    so this is one call
+  for (int begin = 0; begin < probe_count;) {
+    OceanWaveGenerator *ocean = oceans[order[begin]];
+    int end = begin + 1;
+    while (end < probe_count && oceans[order[end]] == ocean) {
+      end++;
+    }
+    if (ocean) {
+      int first = point_offsets[begin];
+      ocean->sample_batch(&points[first], point_offsets[end] - first,
+                          OceanWaveGenerator::SAMPLE_BILINEAR, &heights[first],
+                          nullptr);
+    }
+    begin = end;
+  }
+
+  // 3. Forces
+  for (int slot = 0; slot < probe_count; ++slot) {
+    int i = order[slot];
+    if (!oceans[i])
+      continue;
+    probes[i]->apply_samples(transforms[i], &points[point_offsets[slot]],
+                             &heights[point_offsets[slot]], p_delta);
+  }
+}
+
+void BuoyancySystem::process_bodies(double p_delta) {
+  int body_count = (int)body_rids.size();
+  if (body_count == 0 || !ocean_node || p_delta <= 0.0)
+    return;
+
+  // 1. Transforms from the server, points to world space
+  PhysicsServer3D *physics = PhysicsServer3D::get_singleton();
+  int total = body_offsets[body_count];
+  body_states.resize(body_count);
+  body_points.resize(total);
+  body_heights.resize(total);
+  for (int i = 0; i < body_count; ++i) {
+    PhysicsDirectBodyState3D *state =
+        physics->body_get_direct_state(body_rids[i]);
+    body_states[i] = state;
+    Transform3D transform = state ? state->get_transform() : Transform3D();
+    for (int p = body_offsets[i]; p < body_offsets[i + 1]; ++p) {
+      body_points[p] = transform.xform(body_local_points[p]);
+    }
+  }
+
+  // 2. One query for all debris
+  ocean_node->sample_batch(body_points.data(), total,
+                           OceanWaveGenerator::SAMPLE_BILINEAR,
+                           body_heights.data(), nullptr);
+
+  // 3. Force and torque about the centre of mass, integrated as for the
+  //    probes; debris_buoyancy and debris_drag are already per unit mass
+  for (int i = 0; i < body_count; ++i) {
+    PhysicsDirectBodyState3D *state = body_states[i];
+    if (!state)
+      continue; // freed without remove_body
+    int begin = body_offsets[i];
+    int end = body_offsets[i + 1];
+    float point_mass = body_masses[i] / (end - begin);
+    Vector3 center = state->get_transform().origin + state->get_center_of_mass();
+    Vector3 linear_velocity = state->get_linear_velocity();
+    Vector3 angular_velocity = state->get_angular_velocity();
+    float gravity = -(float)state->get_total_gravity().y;
+
+    Vector3 force;
+    Vector3 torque;
+    bool submerged = false;
+    WaterContact contact;
+    for (int p = begin; p < end; ++p) {
+      Vector3 arm = body_points[p] - center;
+      Vector3 velocity = linear_velocity + angular_velocity.cross(arm);
+      contact.add(body_points[p], body_heights[p], velocity);
+      BuoyantStep step = integrate_buoyant_point(
+          (float)body_points[p].y, (float)velocity.y, body_heights[p],
+          get_height_rate(body_heights[p], body_previous_heights[p], p_delta),
+          debris_buoyancy, debris_drag, gravity, p_delta, debris_substeps);
+      body_previous_heights[p] = body_heights[p];
+      if (!step.wet)
+        continue;
+      submerged = true;
+      Vector3 point_force =
+          (Vector3(velocity.x * (step.horizontal_decay - 1.0f),
+                   step.vertical_velocity - (float)velocity.y,
+                   velocity.z * (step.horizontal_decay - 1.0f)) /
+               (float)p_delta +
+           Vector3(0, gravity, 0)) *
+          point_mass;
+      force += point_force;
+      torque += arm.cross(point_force);
+    }
+    update_water_state(body_water_states[i], contact,
+                       state->get_transform().basis, body_rids[i].get_id(), 0);
+    if (!submerged)
+      continue;
+    physics->body_apply_central_force(body_rids[i], force);
+    physics->body_apply_torque(body_rids[i], torque);
+  }
+}
+
+int BuoyancySystem::get_probe_count() const { return (int)probes.size(); }
+
+void BuoyancySystem::add_body(const RID &p_body,
+                              const PackedVector3Array &p_local_points,
+                              float p_mass) {
+  ERR_FAIL_COND_MSG(!p_body.is_valid(), "Invalid body RID.");
+  ERR_FAIL_COND_MSG(has_body(p_body), "Body is already registered.");
+  ERR_FAIL_COND_MSG(p_mass <= 0.0f, "Mass must be positive.");
+  body_indices[p_body.get_id()] = (int)body_rids.size();
+  body_rids.push_back(p_body);
+  body_masses.push_back(p_mass);
+  if (p_local_points.is_empty()) {
+    body_local_points.push_back(Vector3());
+  } else {
+    for (int i = 0; i < (int)p_local_points.size(); ++i) {
+      body_local_points.push_back(p_local_points[i]);
+    }
+  }
+  body_offsets.push_back((int)body_local_points.size());
+  body_previous_heights.resize(body_local_points.size(), NAN);
+  body_water_states.push_back(0);
+}
+
+void BuoyancySystem::remove_body(const RID &p_body) {
+  std::map<uint64_t, int>::iterator it = body_indices.find(p_body.get_id());
+  ERR_FAIL_COND_MSG(it == body_indices.end(), "Body is not registered.");
+  int index = it->second;
+  body_indices.erase(it);
+
+  // Close the gap in the point array; removal is rare next to the
+  // per-tick passes, which want the points contiguous
+  int begin = body_offsets[index];
+  int end = body_offsets[index + 1];
+  body_local_points.erase(body_local_points.begin() + begin,
+                          body_local_points.begin() + end);
+  body_previous_heights.erase(body_previous_heights.begin() + begin,
+                              body_previous_heights.begin() + end);
+  body_offsets.erase(body_offsets.begin() + index + 1);
+  for (int i = index + 1; i < (int)body_offsets.size(); ++i) {
+    body_offsets[i] -= end - begin;
+  }
+  body_rids.erase(body_rids.begin() + index);
+  body_masses.erase(body_masses.begin() + index);
+  body_water_states.erase(body_water_states.begin() + index);
+  for (int i = index; i < (int)body_rids.size(); ++i) {
+    body_indices[body_rids[i].get_id()] = i;
+  }
+}
+
+bool BuoyancySystem::has_body(const RID &p_body) const {
+  return body_indices.count(p_body.get_id()) > 0;
+}
+
+int BuoyancySystem::get_body_count() const { return (int)body_rids.size(); }
+
+void BuoyancySystem::push_event(const WaterEventRecord &p_event) {
+  if (events.empty())
+    events.resize(MAX_EVENTS);
+  events[(event_head + event_count) % MAX_EVENTS] = p_event;
+  if (event_count < MAX_EVENTS) {
+    event_count++;
+  } else {
+    event_head = (event_head + 1) % MAX_EVENTS;
+  }
+}
+
+Dictionary BuoyancySystem::drain_events() {
+  PackedInt32Array types;
+  PackedInt64Array bodies;
+  PackedInt64Array objects;
+  PackedVector3Array positions;
+  PackedVector3Array velocities;
+  types.resize(event_count);
+  bodies.resize(event_count);
+  objects.resize(event_count);
+  positions.resize(event_count);
+  velocities.resize(event_count);
+  int32_t *type_out = types.ptrw();
+  int64_t *body_out = bodies.ptrw();
+  int64_t *object_out = objects.ptrw();
+  Vector3 *position_out = positions.ptrw();
+  Vector3 *velocity_out = velocities.ptrw();
+  for (int i = 0; i < event_count; ++i) {
+    const WaterEventRecord &event = events[(event_head + i) % MAX_EVENTS];
+    type_out[i] = event.type;
+    body_out[i] = (int64_t)event.body;
+    object_out[i] = (int64_t)event.object;
+    position_out[i] = event.position;
+    velocity_out[i] = event.velocity;
+  }
+  event_head = 0;
+  event_count = 0;
+
+  Dictionary result;
+  result["type"] = types;
+  result["body"] = bodies;
+  result["object_id"] = objects;
+  result["position"] = positions;
+  result["velocity"] = velocities;
+  return result;
+}
+
+int BuoyancySystem::get_pending_event_count() const { return event_count; }
+
+void BuoyancySystem::set_debris_buoyancy(float p_buoyancy) {
+  debris_buoyancy = p_buoyancy;
+}
+
+float BuoyancySystem::get_debris_buoyancy() const { return debris_buoyancy; }
+
+void BuoyancySystem::set_debris_drag(float p_drag) { debris_drag = p_drag; }
+
+float BuoyancySystem::get_debris_drag() const { return debris_drag; }
+
+void BuoyancySystem::set_debris_substeps(int p_substeps) {
+  debris_substeps = std::max(p_substeps, 1);
+}
+
+int BuoyancySystem::get_debris_substeps() const { return debris_substeps; }
+
+void BuoyancySystem::set_ocean_node(const NodePath &p_path) {
+  ocean_node_path = p_path;
+  if (is_inside_tree()) {
+    ocean_node =
+        Object::cast_to<OceanWaveGenerator>(get_node<godot::Node>(p_path));
+  }
+}
+
+NodePath BuoyancySystem::get_ocean_node() const { return ocean_node_path; }
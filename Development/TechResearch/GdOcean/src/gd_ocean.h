@@ -1,37 +1,380 @@
-#ifndef GD_OCEAN_H
+﻿#ifndef GD_OCEAN_H
 #define GD_OCEAN_H
 
+#include <godot_cpp/classes/image.hpp>
 #include <godot_cpp/classes/node.hpp>
 #include <godot_cpp/classes/node3d.hpp>
+#include <godot_cpp/classes/physics_direct_body_state3d.hpp>
 #include <godot_cpp/classes/rigid_body3d.hpp>
+#include <godot_cpp/classes/texture2d.hpp>
+#include <godot_cpp/classes/texture2drd.hpp>
+#include <godot_cpp/variant/dictionary.hpp>
 #include <godot_cpp/variant/node_path.hpp>
+#include <godot_cpp/variant/packed_byte_array.hpp>
+#include <godot_cpp/variant/packed_float32_array.hpp>
+#include <godot_cpp/variant/packed_int32_array.hpp>
+#include <godot_cpp/variant/packed_int64_array.hpp>
+#include <godot_cpp/variant/packed_vector3_array.hpp>
+#include <godot_cpp/variant/rid.hpp>
+#include <godot_cpp/variant/string.hpp>
+#include <godot_cpp/variant/transform3d.hpp>
+#include <godot_cpp/variant/vector2.hpp>
+#include <godot_cpp/variant/vector3.hpp>
 
+#include <atomic>
 #include <vector>
 #include <complex>
+#include <functional>
+#include <map>
+#include <memory>
+
+#include "ocean_fft.h"
+#include "ocean_loop_cache.h"
 
 namespace gd_ocean {
 
 class OceanWaveGenerator : public godot::Node {
     GDCLASS(OceanWaveGenerator, godot::Node)
 
+public:
+    enum SpectrumType {
+        SPECTRUM_PHILLIPS,
+        SPECTRUM_JONSWAP,
+    };
+
+    enum SampleFilter {
+        SAMPLE_BILINEAR,
+        SAMPLE_CATMULL_ROM, // bicubic, 4 x 4 taps
+    };
+
+    enum FFTBackend {
+        FFT_BACKEND_AUTO,      // SIMD or Threaded, timed per resolution
+        FFT_BACKEND_REFERENCE, // radix-2, double precision, for accuracy checks
+        FFT_BACKEND_SIMD,      // radix-4 SoA, one thread
+        FFT_BACKEND_THREADED,  // radix-4 SoA on the WorkerThreadPool
+    };
+
+    // Real fields produced by the batched inverse FFT, one map each
+    enum MapField {
+        MAP_HEIGHT,
+        MAP_DISPLACEMENT_X,
+        MAP_DISPLACEMENT_Z,
+        MAP_SLOPE_X, // dh/dx
+        MAP_SLOPE_Z, // dh/dz
+        // Horizontal displacement derivatives for the Jacobian
+        MAP_DDX_DX,
+        MAP_DDZ_DZ,
+        MAP_DDX_DZ, // equals dDz/dx
+        MAP_COUNT,
+    };
+
 private:
+    static const int MAX_CASCADES = 4;
+    // Neighbouring cascades split the spectrum at this many fundamentals
+    // of the smaller patch, so every band is resolved by several texels
+    static constexpr double CASCADE_BAND_FACTOR = 6.0;
+    static const int PHASE_RESYNC_INTERVAL = 64;
+    static const int FFT_BENCHMARK_RUNS = 3;
+
+    // Triple-buffered output. The simulation task only writes the back
+    // frame; _process publishes it once the task has finished and the
+    // clock has reached the front frame's time, so readers always see two
+    // complete keyframes (previous_frame, front_frame) to blend between.
+    struct Frame {
+        std::vector<float> maps[MAP_COUNT];
+        // Foam coverage 0..1 from the displacement Jacobian, carried over
+        // from the previous frame with exponential decay
+        std::vector<float> foam;
+        int resolution = 0;
+        double size = 0.0;
+        double time = 0.0;
+    };
+
+    // Render thread side of a cascade's RD textures (displacement, normal,
+    // foam). Allocated on the main thread; afterwards only calls queued on
+    // the render thread touch it, and since they run in order the free
+    // call queued last deletes it.
+    struct RDTextureSet {
+        godot::Ref<godot::Texture2DRD> wrappers[3];
+        godot::RID rids[3];
+    };
+
+    // One FFT patch. Each cascade tiles at its own patch size and keeps
+    // only its band [k_min, k_max) of the spectrum, so the sum of all
+    // cascades holds every wavenumber once.
+    struct Cascade {
+        int resolution = 0;
+        double size = 0.0;
+        int update_interval = 1; // simulated every n-th frame or keyframe
+        double k_min = 0.0;
+        double k_max = 0.0; // 0: no upper limit
+        int frames_since_update = 0;
+
+        bool resolution_dirty = true; // buffers and FFT plan
+        bool noise_dirty = true;      // seeded Gaussian noise
+        bool spectrum_dirty = true;   // h0(k) from the current parameters
+
+        OceanFFTPlan *fft = nullptr; // shared through fft_plans
+
+        // FFT Data - h0 is built once, per-frame transform in float32 SoA
+        std::vector<std::complex<float>> gaussian_noise;
+        std::vector<std::complex<float>> h0_k;
+        // Per texel tables on the half plane (same layout as spectrum_re),
+        // rebuilt with the spectrum so the per-frame update is multiplies only
+        std::vector<float> h0_re, h0_im;             // h0(k)
+        std::vector<float> h0_minus_re, h0_minus_im; // conj(h0(-k))
+        std::vector<float> dispersion;               // w(k) = sqrt(g |k|)
+        // kx, kz and kx/|k|, kz/|k|; zero at k = 0 and on the Nyquist lines,
+        // where the odd fields have no Hermitian partner
+        std::vector<float> odd_kx, odd_kz, dir_x, dir_z;
+        // kx^2/|k|, kz^2/|k|, kx kz/|k|: even in k, so the Jacobian fields
+        // keep their Nyquist terms
+        std::vector<float> jacobian_xx, jacobian_zz, jacobian_xz;
+        // e^{iwt} per texel, advanced by multiplying with e^{iw dt} while the
+        // time step stays the same and recomputed exactly every
+        // PHASE_RESYNC_INTERVAL steps to bound the float drift
+        std::vector<float> phase_re, phase_im;
+        std::vector<float> rotation_re, rotation_im;
+        double phase_time = 0.0;
+        double phase_step = -1.0; // dt the rotation table was built for
+        int phase_steps = 0;      // recurrence steps since the last resync
+        bool phase_valid = false;
+
+        // Hermitian half spectra, one per MapField: (resolution / 2 + 1)
+        // columns per kz row. The negative kx half is implied by
+        // h(-k) = conj(h(k)).
+        std::vector<float> spectrum_re[MAP_COUNT];
+        std::vector<float> spectrum_im[MAP_COUNT];
+
+        Frame frames[3];
+        std::atomic<int> front_frame{0};
+        std::atomic<int> previous_frame{0};
+        int sim_target = 1;
+        double sim_time = 0.0;    // time the back frame is simulated for
+        bool sim_pending = false; // simulated by the running task
+        bool sim_ready = false;   // finished, waiting for its publish time
+
+        // GPU copies of the front frame, refreshed each time a frame is
+        // published. Texture2DRD on the main RenderingDevice, ImageTexture
+        // when there is none (Compatibility renderer). The texture objects
+        // are kept across resolution changes, and pixel buffers and images
+        // between frames, so an update allocates no Image.
+        int texture_resolution = 0;
+        RDTextureSet *rd_set = nullptr; // null on the Compatibility path
+        godot::Ref<godot::Texture2D> displacement_texture; // RGBA32F: Dx, height, Dz
+        godot::Ref<godot::Texture2D> normal_texture;       // RGBA8: normal * 0.5 + 0.5
+        godot::Ref<godot::Texture2D> foam_texture;         // R8: coverage
+        godot::Ref<godot::Image> displacement_image;
+        godot::Ref<godot::Image> normal_image;
+        godot::Ref<godot::Image> foam_image;
+        godot::PackedByteArray displacement_bytes;
+        godot::PackedByteArray normal_bytes;
+        godot::PackedByteArray foam_bytes;
+    };
+
     double time;
-    int resolution = 64; 
-    double size = 64.0;
-    
-    // FFT Data - Using double for precision in calculation
-    std::vector<std::complex<double>> h0_k; 
-    std::vector<std::complex<double>> h_k_t;
-    std::vector<std::complex<double>> butterfly_data;
-    std::vector<double> height_map;
+    // Keyframes per second; 0 simulates on every _process. With a fixed
+    // rate each cascade is simulated one keyframe ahead of the clock and
+    // samples blend its two newest keyframes, so the CPU cost no longer
+    // follows the render frame rate.
+    float simulation_rate = 0.0f;
+
+    // Cascade layout. Entry i of each array configures cascade i; the
+    // patch size array sets the cascade count, shorter arrays repeat
+    // their last entry.
+    godot::PackedFloat32Array cascade_patch_sizes;
+    godot::PackedInt32Array cascade_resolutions;
+    godot::PackedInt32Array cascade_update_intervals;
+
+    // Spectrum parameters
+    SpectrumType spectrum_type = SPECTRUM_PHILLIPS;
+    float wind_speed = 10.0f;
+    godot::Vector2 wind_direction = godot::Vector2(1.0f, 0.0f);
+    float fetch = 100.0f; // km, JONSWAP only
+    float peak_enhancement = 3.3f; // JONSWAP gamma
+    float phillips_amplitude = 0.0081f;
+    int seed = 0;
+    float choppiness = 1.0f; // horizontal displacement scale (lambda)
+    bool export_textures = false;
+    FFTBackend fft_backend = FFT_BACKEND_AUTO;
+    // Foam appears where the Jacobian of the choppy displacement drops
+    // below foam_threshold (1 = undisturbed, < 0 = folded), reaching full
+    // coverage 1 - foam_threshold below it, and fades with time constant
+    // foam_decay.
+    float foam_threshold = 0.5f;
+    float foam_decay = 2.0f; // s
+
+    // Looping mode: w(k) is snapped to multiples of 2 pi / loop_period so
+    // the ocean repeats exactly, and loop_frame_count frames of every
+    // cascade are precomputed once into a quantised cache file. Later
+    // runs with the same parameters map that file instead of simulating.
+    // 0 disables looping.
+    float loop_period = 0.0f;
+    int loop_frame_count = 64;
+    godot::String loop_cache_path = "user://ocean_loop.cache";
+    OceanLoopCache loop_cache;
+    double loop_frames_time = -1.0; // time of the decoded loop frames
+
+    // Property changes only mark what has to be rebuilt; the work is done
+    // once on the next _process.
+    bool cascades_dirty = true; // cascade layout
+    bool noise_dirty = true;
+    bool spectrum_dirty = true;
+    bool loop_dirty = true;     // loop cache
+    bool fft_dirty = false;     // FFT plans, after a backend change
+
+    std::vector<std::unique_ptr<Cascade>> cascades;
+    // One plan per resolution, shared by every cascade of that size.
+    // Cascades are simulated one after another, so a plan's scratch
+    // buffers are never used twice at once.
+    std::map<int, std::unique_ptr<OceanFFTPlan>> fft_plans;
+    OceanFFT::ParallelFor fft_parallel_for;
+
+    // Set before each task
+    float sim_choppiness = 1.0f;
+    float sim_foam_threshold = 0.5f;
+    float sim_foam_decay = 2.0f;
+    int64_t sim_task = -1;
+
+    // Loop cache written on the pool from copies of the cascades' spectrum
+    // tables, so the live simulation runs until the cache can be mapped
+    struct LoopBuild {
+        std::vector<std::unique_ptr<Cascade>> cascades;
+        std::vector<std::unique_ptr<OceanFFTPlan>> plans;
+        std::string path;
+        uint64_t hash = 0;
+        float period = 0.0f;
+        int frame_count = 0;
+        float choppiness = 1.0f;
+        std::atomic<bool> cancel{false};
+        std::atomic<bool> written{false};
+    };
+    std::unique_ptr<LoopBuild> loop_build;
+    int64_t loop_build_task = -1;
+    // Job of the WorkerThreadPool group task currently run by the FFT
+    const std::function<void(int)>* group_job = nullptr;
+
+    // Debugger monitors, listed under "Ocean" in the Monitors tab
+    enum Monitor {
+        MONITOR_SPECTRUM_TIME,      // ms, spectrum update of the last task
+        MONITOR_FFT_TIME,           // ms, IFFTs of the last task
+        MONITOR_SAMPLES,            // points sampled during the last tick
+        MONITOR_BATCH_SIZE,         // mean points per sampling call
+        MONITOR_CACHE_HIT_RATE,     // %, phase updates served by the recurrence
+        MONITOR_THREAD_UTILISATION, // %, share of wall time the task ran
+        MONITOR_COUNT,
+    };
+    // Written by the running task only, read once it has been joined
+    struct TaskTimings {
+        uint64_t start_usec = 0;
+        uint64_t end_usec = 0;
+        uint64_t spectrum_usec = 0;
+        uint64_t fft_usec = 0;
+        int phase_hits = 0;
+        int phase_updates = 0;
+    };
+    TaskTimings task_timings;
+    double monitor_values[MONITOR_COUNT] = {};
+    // Rates are averaged over about a second
+    uint64_t monitor_window_usec = 0;
+    uint64_t monitor_busy_usec = 0;
+    int monitor_phase_hits = 0;
+    int monitor_phase_updates = 0;
+    // Queries may come from physics threads
+    mutable std::atomic<int64_t> sampled_points{0};
+    mutable std::atomic<int64_t> sample_calls{0};
+    bool monitors_registered = false;
 
     void init_spectrum();
-    void perform_fft(std::vector<std::complex<double>>& data, int n);
-    void bit_reverse_copy(const std::vector<std::complex<double>>& src, std::vector<std::complex<double>>& dst, int n);
-    unsigned int reverse_bits(unsigned int num, int log2n);
+    // Applies the cascade arrays: count, grids and spectrum bands
+    void rebuild_cascades();
+    void init_cascade(Cascade &p_cascade, int p_index);
+    OceanFFTPlan *get_fft_plan(int p_resolution);
+    std::unique_ptr<OceanFFTPlan> create_fft_plan(FFTBackend p_backend, int p_resolution);
+    // Times a batch of MAP_COUNT transforms with the SIMD and Threaded
+    // backends and returns the faster plan
+    std::unique_ptr<OceanFFTPlan> benchmark_fft_plans(int p_resolution);
+    // Maps the loop cache, or starts writing it on the pool when missing
+    // or stale
+    void build_loop_cache();
+    // Task body of the cache build, then its completion on the main
+    // thread: maps the written cache unless the build was cancelled
+    void run_loop_build();
+    void finish_loop_build();
+    // Stops a running build, e.g. because the parameters changed again
+    void cancel_loop_build();
+    // Identifies every parameter baked into the loop cache
+    uint64_t get_loop_hash() const;
+    // Decodes and publishes every cascade's loop frame for the current
+    // time, once per tick, so textures and foam follow the loop
+    void sync_loop_frames();
+    // Time-interpolated loop frame at p_time into the cascade's back frame
+    void decode_loop_frame(int p_cascade, double p_time);
+    // Directional wavenumber spectrum S(kx, kz) in m^4
+    double evaluate_spectrum(double kx, double kz) const;
+    void run_group_job(uint32_t p_index);
+    // Brings the cascade's phase tables to e^{iw p_time}
+    void advance_phase(Cascade &p_cascade, double p_time,
+                       TaskTimings &r_timings);
+    // Spectrum update and batched IFFT of every pending cascade for its
+    // sim_time into its back frame
+    void simulate_frame();
+    void simulate_cascade(Cascade &p_cascade, float p_choppiness,
+                          TaskTimings &r_timings);
+    // Foam of p_frame from its Jacobian maps and the decayed p_previous
+    void update_foam(Frame &p_frame, const Frame &p_previous) const;
+    // Waits for the running task, marks its frames ready and collects
+    // its timings
+    void wait_for_simulation();
+    // The first generator in the tree owns the monitors
+    void register_monitors();
+    void unregister_monitors();
+    // Per tick sample counts and the windowed rates
+    void update_monitors();
+    double get_monitor(int p_monitor) const;
+    // The frame neither readable nor blended: the only one the
+    // simulation may write
+    static int get_back_frame(const Cascade &p_cascade);
+    // Moves the finished back frame to the front; the old front becomes
+    // the previous keyframe
+    void publish_frame(Cascade &p_cascade);
+    void create_textures(Cascade &p_cascade, int p_resolution);
+    // Releases the cascade's textures; its RD set, if any, is appended
+    // to r_rd_sets for queue_free_rd_sets
+    void free_textures(Cascade &p_cascade, godot::PackedInt64Array &r_rd_sets);
+    static void queue_free_rd_sets(const godot::PackedInt64Array &p_sets);
+    // Render thread side of the RD textures; p_set is an RDTextureSet *
+    static void create_rd_textures(uint64_t p_set, int p_resolution);
+    static void update_rd_textures(uint64_t p_set,
+                                   const godot::PackedByteArray &p_displacement,
+                                   const godot::PackedByteArray &p_normal,
+                                   const godot::PackedByteArray &p_foam);
+    static void free_rd_sets(const godot::PackedInt64Array &p_sets);
+    // Packs the cascade's front frame and uploads it to both textures
+    void update_textures(Cascade &p_cascade);
+    // Up to three fields of one cascade frame, as float maps or as int16
+    // maps with scales when read from the loop cache
+    struct SampleLayer {
+        const float *maps[3] = {};
+        const int16_t *quantised[3] = {};
+        float scales[3] = {1.0f, 1.0f, 1.0f};
+        int resolution = 0;
+        double size = 0.0;
+        double weight = 1.0;
+    };
+    // Everything summed by a lookup of p_fields: the two newest keyframes
+    // of every cascade, or two cached frames in loop mode, blended in
+    // time. r_layers holds MAX_SAMPLE_LAYERS, returns the count.
+    static const int MAX_SAMPLE_LAYERS = MAX_CASCADES * 2;
+    int get_sample_layers(const MapField *p_fields, int p_count, SampleLayer *r_layers) const;
+    static void sample_layers(const SampleLayer *p_layers, int p_layer_count, int p_count, bool p_cubic, float x, float z, double *r_sums);
+    // Bilinear, periodic lookup of one map at world (x, z), summed over
+    // all cascades
+    float sample_map(MapField p_field, float x, float z) const;
 
 protected:
     static void _bind_methods();
+    void _notification(int p_what);
 
 public:
     OceanWaveGenerator();
@@ -41,10 +384,105 @@ public:
     
     // API
     float get_wave_height(float x, float z);
+    // Water height (m) and gradient (dh/dx, dh/dz) at many points at
+    // once; r_gradients may be null
+    void sample_batch(const godot::Vector3 *p_positions, int p_count, SampleFilter p_filter, float *r_heights, godot::Vector2 *r_gradients) const;
+    godot::PackedFloat32Array sample_heights(const godot::PackedVector3Array& p_positions, SampleFilter p_filter = SAMPLE_BILINEAR) const;
+    // Vector3(dh/dx, height, dh/dz) per position
+    godot::PackedVector3Array sample_heights_and_gradients(const godot::PackedVector3Array& p_positions, SampleFilter p_filter = SAMPLE_BILINEAR) const;
+    // Surface point that the undisplaced grid point (x, z) moves to
+    godot::Vector3 get_displaced_position(float x, float z) const;
+    // Surface normal from the FFT slope maps
+    godot::Vector3 get_wave_normal(float x, float z) const;
+
+    // Runs the float32 engine and the double reference path on the same
+    // spectrum and reports error and timing.
+    godot::Dictionary compare_fft_accuracy(int p_resolution);
+
+    void set_spectrum_type(SpectrumType p_type);
+    SpectrumType get_spectrum_type() const;
+
+    void set_resolution(int p_resolution);
+    int get_resolution() const;
+
+    void set_patch_size(float p_size);
+    float get_patch_size() const;
+
+    void set_wind_speed(float p_speed);
+    float get_wind_speed() const;
+
+    void set_wind_direction(const godot::Vector2& p_direction);
+    godot::Vector2 get_wind_direction() const;
+
+    void set_fetch(float p_fetch);
+    float get_fetch() const;
+
+    void set_peak_enhancement(float p_gamma);
+    float get_peak_enhancement() const;
+
+    void set_phillips_amplitude(float p_amplitude);
+    float get_phillips_amplitude() const;
+
+    void set_seed(int p_seed);
+    int get_seed() const;
+
+    void set_choppiness(float p_choppiness);
+    float get_choppiness() const;
+
+    void set_export_textures(bool p_enabled);
+    bool get_export_textures() const;
+
+    void set_cascade_patch_sizes(const godot::PackedFloat32Array& p_sizes);
+    godot::PackedFloat32Array get_cascade_patch_sizes() const;
+
+    void set_cascade_resolutions(const godot::PackedInt32Array& p_resolutions);
+    godot::PackedInt32Array get_cascade_resolutions() const;
+
+    void set_cascade_update_intervals(const godot::PackedInt32Array& p_intervals);
+    godot::PackedInt32Array get_cascade_update_intervals() const;
+
+    int get_cascade_count() const;
+
+    void set_simulation_rate(float p_rate);
+    float get_simulation_rate() const;
+
+    void set_fft_backend(FFTBackend p_backend);
+    FFTBackend get_fft_backend() const;
+    // Implementation actually used by a cascade, resolved when AUTO
+    godot::String get_active_fft_backend(int p_cascade = 0) const;
+
+    void set_loop_period(float p_period);
+    float get_loop_period() const;
+
+    void set_loop_frame_count(int p_count);
+    int get_loop_frame_count() const;
+
+    void set_loop_cache_path(const godot::String& p_path);
+    godot::String get_loop_cache_path() const;
+
+    godot::Ref<godot::Texture2D> get_displacement_texture(int p_cascade = 0) const;
+    godot::Ref<godot::Texture2D> get_normal_texture(int p_cascade = 0) const;
+    godot::Ref<godot::Texture2D> get_foam_texture(int p_cascade = 0) const;
+
+    void set_foam_threshold(float p_threshold);
+    float get_foam_threshold() const;
+
+    void set_foam_decay(float p_decay);
+    float get_foam_decay() const;
+
+    // Foam coverage of one cascade, resolution^2 values row-major
+    godot::PackedFloat32Array get_foam_map(int p_cascade = 0);
+    // Displaced surface points of texels with at least p_min_coverage
+    // foam, placed in the patch tile centred on p_center and thinned
+    // evenly to p_max_points
+    godot::PackedVector3Array get_foam_spawn_points(const godot::Vector3& p_center, float p_min_coverage, int p_max_points, int p_cascade = 0);
 };
 
+class BuoyancySystem;
+
 class BuoyancyProbe3D : public godot::RigidBody3D {
     GDCLASS(BuoyancyProbe3D, godot::RigidBody3D)
+    friend class BuoyancySystem;
 
 private:
     float buoyancy_force;
@@ -52,8 +490,36 @@ private:
     godot::NodePath ocean_node_path;
     OceanWaveGenerator* ocean_node;
 
+    // Sample points in body space; empty samples the body origin only.
+    // Entry i scales buoyancy_force and water_drag at point i, shorter
+    // arrays repeat their last entry.
+    godot::PackedVector3Array probe_points;
+    godot::PackedFloat32Array probe_volumes;
+    godot::PackedFloat32Array probe_drags;
+    // Buoyancy and drag are integrated analytically over this many
+    // sub-steps per physics tick
+    int substeps = 4;
+    // Scratch for the batched ocean query, kept between ticks
+    std::vector<godot::Vector3> sample_points;
+    std::vector<float> sample_heights;
+    // Last tick's water height per point, NaN until sampled, for the
+    // surface's vertical speed
+    std::vector<float> previous_heights;
+
+    // Slot in BuoyancySystem's probe list while in the tree, -1 otherwise
+    int system_index = -1;
+    // BuoyancySystem::WATER_STATE_* flags as of the last tick
+    uint8_t water_state = 0;
+
+    int get_sample_count() const;
+    void get_sample_points(const godot::Transform3D& p_transform, godot::Vector3* r_points) const;
+    // Buoyancy and drag from the water heights at p_points over p_delta,
+    // applied as one central force and one torque
+    void apply_samples(const godot::Transform3D& p_transform, const godot::Vector3* p_points, const float* p_heights, double p_delta);
+
 protected:
     static void _bind_methods();
+    void _notification(int p_what);
 
 public:
     BuoyancyProbe3D();
@@ -70,8 +536,161 @@ public:
 
     void set_ocean_node(const godot::NodePath& p_path);
     godot::NodePath get_ocean_node() const;
+
+    void set_probe_points(const godot::PackedVector3Array& p_points);
+    godot::PackedVector3Array get_probe_points() const;
+
+    void set_probe_volumes(const godot::PackedFloat32Array& p_volumes);
+    godot::PackedFloat32Array get_probe_volumes() const;
+
+    void set_probe_drags(const godot::PackedFloat32Array& p_drags);
+    godot::PackedFloat32Array get_probe_drags() const;
+
+    void set_substeps(int p_substeps);
+    int get_substeps() const;
+};
+
+// Runs every BuoyancyProbe3D in the tree from one physics tick. Probes
+// register themselves on entering the tree; while a system is active
+// their own _physics_process is off. Each tick the probe transforms and
+// sample points are gathered into flat arrays, every ocean is queried
+// once for all its points and the forces are applied.
+//
+// Bodies without a node (debris created straight on PhysicsServer3D)
+// are added by RID with their sample points and mass, and are read and
+// pushed through the server in the same tick.
+//
+// Probes and bodies report when they enter the water, go under, capsize
+// or surface. The events collect in one ring buffer for scripts to drain
+// once per frame with drain_events().
+class BuoyancySystem : public godot::Node {
+    GDCLASS(BuoyancySystem, godot::Node)
+
+public:
+    enum WaterEvent {
+        EVENT_ENTERED_WATER, // first point under water
+        EVENT_SUBMERGED,     // every point under water
+        EVENT_CAPSIZED,      // up axis tipped below the horizon while wet
+        EVENT_SURFACED,      // a point back above water after EVENT_SUBMERGED
+    };
+
+    // Per body state the events are transitions of
+    enum WaterState {
+        WATER_STATE_WET = 1,
+        WATER_STATE_SUBMERGED = 2,
+        WATER_STATE_CAPSIZED = 4,
+    };
+
+    struct WaterEventRecord {
+        WaterEvent type = EVENT_ENTERED_WATER;
+        uint64_t body = 0;   // RID id
+        uint64_t object = 0; // instance id of the probe, 0 for server bodies
+        godot::Vector3 position; // on the surface where the body crossed it
+        godot::Vector3 velocity; // of the body at that point
+    };
+
+private:
+    // Oldest events are overwritten once full
+    static const int MAX_EVENTS = 1024;
+    static std::vector<WaterEventRecord> events;
+    static int event_head; // oldest pending event
+    static int event_count;
+
+    // Probes in the tree, whether or not a system is active
+    static std::vector<BuoyancyProbe3D*> probes;
+    // Systems in the tree, in the order they entered; the first one
+    // drives all probes and hands them to the next when it leaves
+    static std::vector<BuoyancySystem*> systems;
+    static BuoyancySystem* active_system;
+
+    godot::NodePath ocean_node_path;
+    OceanWaveGenerator* ocean_node = nullptr; // for probes without their own
+
+    // Per probe, rebuilt each tick
+    std::vector<godot::Transform3D> transforms;
+    std::vector<OceanWaveGenerator*> oceans;
+    // Probe indices sorted by ocean; the probe in slot s owns points
+    // [point_offsets[s], point_offsets[s + 1])
+    std::vector<int> order;
+    std::vector<int> point_offsets;
+    // Per sample point
+    std::vector<godot::Vector3> points;
+    std::vector<float> heights;
+
+    // Server bodies. Body i owns local points [body_offsets[i],
+    // body_offsets[i + 1]); each point carries mass / point count.
+    std::vector<godot::RID> body_rids;
+    std::vector<float> body_masses;
+    std::vector<int> body_offsets{0};
+    std::vector<godot::Vector3> body_local_points;
+    std::map<uint64_t, int> body_indices; // RID id to body index
+    // Buoyant acceleration per metre of depth and linear drag rate, the
+    // same for every server body
+    float debris_buoyancy = 20.0f; // m/s^2 per m
+    float debris_drag = 2.0f;      // 1/s per m
+    int debris_substeps = 4;
+    // Per body and per point, rebuilt each tick
+    std::vector<godot::PhysicsDirectBodyState3D*> body_states;
+    std::vector<godot::Vector3> body_points;
+    std::vector<float> body_heights;
+    // Per point, kept across ticks like body_local_points; NaN until
+    // the first sample
+    std::vector<float> body_previous_heights;
+    std::vector<uint8_t> body_water_states; // per body, WATER_STATE_* flags
+
+    static void set_probes_processing(bool p_enabled);
+    // Drops this system from systems, promoting the next one if it was
+    // active
+    void leave_systems();
+    void process_probes(double p_delta);
+    void process_bodies(double p_delta);
+
+protected:
+    static void _bind_methods();
+    void _notification(int p_what);
+
+public:
+    BuoyancySystem();
+    ~BuoyancySystem();
+
+    void _physics_process(double delta) override;
+
+    static void register_probe(BuoyancyProbe3D* p_probe);
+    static void unregister_probe(BuoyancyProbe3D* p_probe);
+    static BuoyancySystem* get_active_system() { return active_system; }
+    static void push_event(const WaterEventRecord& p_event);
+
+    // Everything since the last call as packed arrays under "type",
+    // "body" (RID ids), "object_id", "position" and "velocity"
+    godot::Dictionary drain_events();
+    int get_pending_event_count() const;
+
+    int get_probe_count() const;
+
+    // p_local_points are in body space; empty samples the body origin
+    void add_body(const godot::RID& p_body, const godot::PackedVector3Array& p_local_points, float p_mass);
+    void remove_body(const godot::RID& p_body);
+    bool has_body(const godot::RID& p_body) const;
+    int get_body_count() const;
+
+    void set_debris_buoyancy(float p_buoyancy);
+    float get_debris_buoyancy() const;
+
+    void set_debris_drag(float p_drag);
+    float get_debris_drag() const;
+
+    void set_debris_substeps(int p_substeps);
+    int get_debris_substeps() const;
+
+    void set_ocean_node(const godot::NodePath& p_path);
+    godot::NodePath get_ocean_node() const;
 };
 
 }
 
+VARIANT_ENUM_CAST(gd_ocean::OceanWaveGenerator::SpectrumType);
+VARIANT_ENUM_CAST(gd_ocean::OceanWaveGenerator::SampleFilter);
+VARIANT_ENUM_CAST(gd_ocean::OceanWaveGenerator::FFTBackend);
+VARIANT_ENUM_CAST(gd_ocean::BuoyancySystem::WaterEvent);
+
 #endif
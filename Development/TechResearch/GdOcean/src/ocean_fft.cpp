@@ -0,0 +1,533 @@
+#include "ocean_fft.h"
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define OCEAN_FFT_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define OCEAN_FFT_TARGET_AVX2
+#else
+#define OCEAN_FFT_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#endif
+#endif
+
+using namespace gd_ocean;
+
+namespace {
+
+typedef void (*Radix4Kernel)(float *re, float *im, int n, int q,
+                             const float *w1_re, const float *w1_im,
+                             const float *w2_re, const float *w2_im);
+
+// Fused pair of radix-2 DIT stages (block sizes 2q and 4q), inverse sign.
+// For each block and j < q:
+//   b0 = a0 + w1 a1, b1 = a0 - w1 a1, b2 = a2 + w1 a3, b3 = a2 - w1 a3
+//   y0 = b0 + w2 b2, y2 = b0 - w2 b2, y1 = b1 + i w2 b3, y3 = b1 - i w2 b3
+void radix4_scalar(float *re, float *im, int n, int q, const float *w1_re,
+                   const float *w1_im, const float *w2_re,
+                   const float *w2_im) {
+  for (int k = 0; k < n; k += 4 * q) {
+    float *r0 = re + k, *r1 = r0 + q, *r2 = r1 + q, *r3 = r2 + q;
+    float *i0 = im + k, *i1 = i0 + q, *i2 = i1 + q, *i3 = i2 + q;
+    for (int j = 0; j < q; ++j) {
+      float t1r = w1_re[j] * r1[j] - w1_im[j] * i1[j];
+      float t1i = w1_re[j] * i1[j] + w1_im[j] * r1[j];
+      float t3r = w1_re[j] * r3[j] - w1_im[j] * i3[j];
+      float t3i = w1_re[j] * i3[j] + w1_im[j] * r3[j];
+
+      float b0r = r0[j] + t1r, b0i = i0[j] + t1i;
+      float b1r = r0[j] - t1r, b1i = i0[j] - t1i;
+      float b2r = r2[j] + t3r, b2i = i2[j] + t3i;
+      float b3r = r2[j] - t3r, b3i = i2[j] - t3i;
+
+      float t2r = w2_re[j] * b2r - w2_im[j] * b2i;
+      float t2i = w2_re[j] * b2i + w2_im[j] * b2r;
+      // i * (w2 * b3)
+      float t4r = -(w2_re[j] * b3i + w2_im[j] * b3r);
+      float t4i = w2_re[j] * b3r - w2_im[j] * b3i;
+
+      r0[j] = b0r + t2r;
+      i0[j] = b0i + t2i;
+      r2[j] = b0r - t2r;
+      i2[j] = b0i - t2i;
+      r1[j] = b1r + t4r;
+      i1[j] = b1i + t4i;
+      r3[j] = b1r - t4r;
+      i3[j] = b1i - t4i;
+    }
+  }
+}
+
+#ifdef OCEAN_FFT_X86
+void radix4_sse(float *re, float *im, int n, int q, const float *w1_re,
+                const float *w1_im, const float *w2_re, const float *w2_im) {
+  for (int k = 0; k < n; k += 4 * q) {
+    float *r0 = re + k, *r1 = r0 + q, *r2 = r1 + q, *r3 = r2 + q;
+    float *i0 = im + k, *i1 = i0 + q, *i2 = i1 + q, *i3 = i2 + q;
+    for (int j = 0; j < q; j += 4) {
+      __m128 w1r = _mm_loadu_ps(w1_re + j), w1i = _mm_loadu_ps(w1_im + j);
+      __m128 w2r = _mm_loadu_ps(w2_re + j), w2i = _mm_loadu_ps(w2_im + j);
+      __m128 a0r = _mm_loadu_ps(r0 + j), a0i = _mm_loadu_ps(i0 + j);
+      __m128 a1r = _mm_loadu_ps(r1 + j), a1i = _mm_loadu_ps(i1 + j);
+      __m128 a2r = _mm_loadu_ps(r2 + j), a2i = _mm_loadu_ps(i2 + j);
+      __m128 a3r = _mm_loadu_ps(r3 + j), a3i = _mm_loadu_ps(i3 + j);
+
+      __m128 t1r = _mm_sub_ps(_mm_mul_ps(w1r, a1r), _mm_mul_ps(w1i, a1i));
+      __m128 t1i = _mm_add_ps(_mm_mul_ps(w1r, a1i), _mm_mul_ps(w1i, a1r));
+      __m128 t3r = _mm_sub_ps(_mm_mul_ps(w1r, a3r), _mm_mul_ps(w1i, a3i));
+      __m128 t3i = _mm_add_ps(_mm_mul_ps(w1r, a3i), _mm_mul_ps(w1i, a3r));
+
+      __m128 b0r = _mm_add_ps(a0r, t1r), b0i = _mm_add_ps(a0i, t1i);
+      __m128 b1r = _mm_sub_ps(a0r, t1r), b1i = _mm_sub_ps(a0i, t1i);
+      __m128 b2r = _mm_add_ps(a2r, t3r), b2i = _mm_add_ps(a2i, t3i);
+      __m128 b3r = _mm_sub_ps(a2r, t3r), b3i = _mm_sub_ps(a2i, t3i);
+
+      __m128 t2r = _mm_sub_ps(_mm_mul_ps(w2r, b2r), _mm_mul_ps(w2i, b2i));
+      __m128 t2i = _mm_add_ps(_mm_mul_ps(w2r, b2i), _mm_mul_ps(w2i, b2r));
+      __m128 t4r = _mm_sub_ps(_mm_setzero_ps(),
+                              _mm_add_ps(_mm_mul_ps(w2r, b3i),
+                                         _mm_mul_ps(w2i, b3r)));
+      __m128 t4i = _mm_sub_ps(_mm_mul_ps(w2r, b3r), _mm_mul_ps(w2i, b3i));
+
+      _mm_storeu_ps(r0 + j, _mm_add_ps(b0r, t2r));
+      _mm_storeu_ps(i0 + j, _mm_add_ps(b0i, t2i));
+      _mm_storeu_ps(r2 + j, _mm_sub_ps(b0r, t2r));
+      _mm_storeu_ps(i2 + j, _mm_sub_ps(b0i, t2i));
+      _mm_storeu_ps(r1 + j, _mm_add_ps(b1r, t4r));
+      _mm_storeu_ps(i1 + j, _mm_add_ps(b1i, t4i));
+      _mm_storeu_ps(r3 + j, _mm_sub_ps(b1r, t4r));
+      _mm_storeu_ps(i3 + j, _mm_sub_ps(b1i, t4i));
+    }
+  }
+}
+
+OCEAN_FFT_TARGET_AVX2
+void radix4_avx2(float *re, float *im, int n, int q, const float *w1_re,
+                 const float *w1_im, const float *w2_re, const float *w2_im) {
+  for (int k = 0; k < n; k += 4 * q) {
+    float *r0 = re + k, *r1 = r0 + q, *r2 = r1 + q, *r3 = r2 + q;
+    float *i0 = im + k, *i1 = i0 + q, *i2 = i1 + q, *i3 = i2 + q;
+    for (int j = 0; j < q; j += 8) {
+      __m256 w1r = _mm256_loadu_ps(w1_re + j), w1i = _mm256_loadu_ps(w1_im + j);
+      __m256 w2r = _mm256_loadu_ps(w2_re + j), w2i = _mm256_loadu_ps(w2_im + j);
+      __m256 a0r = _mm256_loadu_ps(r0 + j), a0i = _mm256_loadu_ps(i0 + j);
+      __m256 a1r = _mm256_loadu_ps(r1 + j), a1i = _mm256_loadu_ps(i1 + j);
+      __m256 a2r = _mm256_loadu_ps(r2 + j), a2i = _mm256_loadu_ps(i2 + j);
+      __m256 a3r = _mm256_loadu_ps(r3 + j), a3i = _mm256_loadu_ps(i3 + j);
+
+      __m256 t1r = _mm256_fmsub_ps(w1r, a1r, _mm256_mul_ps(w1i, a1i));
+      __m256 t1i = _mm256_fmadd_ps(w1r, a1i, _mm256_mul_ps(w1i, a1r));
+      __m256 t3r = _mm256_fmsub_ps(w1r, a3r, _mm256_mul_ps(w1i, a3i));
+      __m256 t3i = _mm256_fmadd_ps(w1r, a3i, _mm256_mul_ps(w1i, a3r));
+
+      __m256 b0r = _mm256_add_ps(a0r, t1r), b0i = _mm256_add_ps(a0i, t1i);
+      __m256 b1r = _mm256_sub_ps(a0r, t1r), b1i = _mm256_sub_ps(a0i, t1i);
+      __m256 b2r = _mm256_add_ps(a2r, t3r), b2i = _mm256_add_ps(a2i, t3i);
+      __m256 b3r = _mm256_sub_ps(a2r, t3r), b3i = _mm256_sub_ps(a2i, t3i);
+
+      __m256 t2r = _mm256_fmsub_ps(w2r, b2r, _mm256_mul_ps(w2i, b2i));
+      __m256 t2i = _mm256_fmadd_ps(w2r, b2i, _mm256_mul_ps(w2i, b2r));
+      // i * (w2 * b3) = (-(w2r b3i + w2i b3r), w2r b3r - w2i b3i)
+      __m256 t4r = _mm256_fnmsub_ps(w2r, b3i, _mm256_mul_ps(w2i, b3r));
+      __m256 t4i = _mm256_fmsub_ps(w2r, b3r, _mm256_mul_ps(w2i, b3i));
+
+      _mm256_storeu_ps(r0 + j, _mm256_add_ps(b0r, t2r));
+      _mm256_storeu_ps(i0 + j, _mm256_add_ps(b0i, t2i));
+      _mm256_storeu_ps(r2 + j, _mm256_sub_ps(b0r, t2r));
+      _mm256_storeu_ps(i2 + j, _mm256_sub_ps(b0i, t2i));
+      _mm256_storeu_ps(r1 + j, _mm256_add_ps(b1r, t4r));
+      _mm256_storeu_ps(i1 + j, _mm256_add_ps(b1i, t4i));
+      _mm256_storeu_ps(r3 + j, _mm256_sub_ps(b1r, t4r));
+      _mm256_storeu_ps(i3 + j, _mm256_sub_ps(b1i, t4i));
+    }
+  }
+}
+#endif
+
+int simd_width(OceanFFT::SimdLevel p_level) {
+  switch (p_level) {
+  case OceanFFT::SIMD_AVX2:
+    return 8;
+  case OceanFFT::SIMD_SSE:
+    return 4;
+  default:
+    return 1;
+  }
+}
+
+Radix4Kernel select_kernel(OceanFFT::SimdLevel p_level, int q) {
+#ifdef OCEAN_FFT_X86
+  // Narrow stages (q below the lane count) fall back to scalar
+  if (q >= simd_width(p_level)) {
+    if (p_level == OceanFFT::SIMD_AVX2)
+      return radix4_avx2;
+    if (p_level == OceanFFT::SIMD_SSE)
+      return radix4_sse;
+  }
+#endif
+  return radix4_scalar;
+}
+
+} // namespace
+
+OceanFFT::SimdLevel OceanFFT::detect_simd_level() {
+#ifdef OCEAN_FFT_X86
+#if defined(_MSC_VER) && !defined(__clang__)
+  int info[4];
+  __cpuid(info, 0);
+  if (info[0] >= 7) {
+    __cpuid(info, 1);
+    bool fma = (info[2] & (1 << 12)) != 0;
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool avx = (info[2] & (1 << 28)) != 0;
+    __cpuidex(info, 7, 0);
+    bool avx2 = (info[1] & (1 << 5)) != 0;
+    // The OS must also save YMM state on context switches
+    if (fma && osxsave && avx && avx2 && (_xgetbv(0) & 0x6) == 0x6)
+      return SIMD_AVX2;
+  }
+#else
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+    return SIMD_AVX2;
+#endif
+  // SSE2 is part of the x86-64 baseline
+  return SIMD_SSE;
+#else
+  return SIMD_SCALAR;
+#endif
+}
+
+const char *OceanFFT::get_simd_level_name(SimdLevel p_level) {
+  switch (p_level) {
+  case SIMD_AVX2:
+    return "AVX2";
+  case SIMD_SSE:
+    return "SSE";
+  default:
+    return "Scalar";
+  }
+}
+
+void OceanFFT::Plan::build(int p_n) {
+  const double PI = 3.14159265358979323846;
+  n = p_n;
+  int log2n = 0;
+  while ((1 << log2n) < n)
+    log2n++;
+
+  swap_pairs.clear();
+  for (int i = 0; i < n; ++i) {
+    int rev = 0;
+    for (int b = 0; b < log2n; ++b) {
+      if (i & (1 << b))
+        rev |= 1 << (log2n - 1 - b);
+    }
+    if (i < rev) {
+      swap_pairs.push_back(i);
+      swap_pairs.push_back(rev);
+    }
+  }
+
+  leading_radix2 = (log2n & 1) != 0;
+  stage_q.clear();
+  stage_offset.clear();
+  w1_re.clear();
+  w1_im.clear();
+  w2_re.clear();
+  w2_im.clear();
+  for (int q = leading_radix2 ? 2 : 1; 4 * q <= n; q *= 4) {
+    stage_q.push_back(q);
+    stage_offset.push_back((int)w1_re.size());
+    for (int j = 0; j < q; ++j) {
+      // Twiddles in double, then rounded once
+      double a1 = 2.0 * PI * j / (2.0 * q);
+      double a2 = 2.0 * PI * j / (4.0 * q);
+      w1_re.push_back((float)std::cos(a1));
+      w1_im.push_back((float)std::sin(a1));
+      w2_re.push_back((float)std::cos(a2));
+      w2_im.push_back((float)std::sin(a2));
+    }
+  }
+}
+
+OceanFFT::OceanFFT() { simd_level = detect_simd_level(); }
+
+void OceanFFT::setup(int p_size) {
+  const double PI = 3.14159265358979323846;
+  size = p_size;
+  column_plan.build(size);
+  row_plan.build(size / 2);
+
+  int half = size / 2;
+  pack_re.resize(half);
+  pack_im.resize(half);
+  for (int k = 0; k < half; ++k) {
+    double a = 2.0 * PI * k / size;
+    pack_re[k] = (float)std::cos(a);
+    pack_im[k] = (float)std::sin(a);
+  }
+}
+
+void OceanFFT::set_parallel_for(const ParallelFor &p_parallel_for,
+                                int p_worker_count) {
+  parallel_for = p_parallel_for;
+  worker_count = std::max(1, p_worker_count);
+}
+
+void OceanFFT::run_ranges(int p_items,
+                          const std::function<void(int, int)> &p_range_job) const {
+  if (!parallel_for || size < MIN_PARALLEL_SIZE || worker_count < 2) {
+    p_range_job(0, p_items);
+    return;
+  }
+  // A few ranges per worker to even out load, kept tile aligned so the
+  // transposes never share a tile between tasks
+  int tasks = std::min(worker_count * 2, p_items / TRANSPOSE_TILE);
+  if (tasks < 2) {
+    p_range_job(0, p_items);
+    return;
+  }
+  int tiles = (p_items + TRANSPOSE_TILE - 1) / TRANSPOSE_TILE;
+  int tiles_per_task = (tiles + tasks - 1) / tasks;
+  int chunk = tiles_per_task * TRANSPOSE_TILE;
+  tasks = (p_items + chunk - 1) / chunk;
+  parallel_for(tasks, [&](int p_task) {
+    int begin = p_task * chunk;
+    int end = std::min(p_items, begin + chunk);
+    p_range_job(begin, end);
+  });
+}
+
+void OceanFFT::transpose_rows(const float *src, int p_rows, int p_cols,
+                              float *dst, int p_row_begin, int p_row_end) {
+  for (int r0 = p_row_begin; r0 < p_row_end; r0 += TRANSPOSE_TILE) {
+    int r1 = std::min(std::min(r0 + TRANSPOSE_TILE, p_row_end), p_rows);
+    for (int c0 = 0; c0 < p_cols; c0 += TRANSPOSE_TILE) {
+      int c1 = std::min(c0 + TRANSPOSE_TILE, p_cols);
+      for (int r = r0; r < r1; ++r) {
+        const float *s = src + r * p_cols;
+        for (int c = c0; c < c1; ++c) {
+          dst[c * p_rows + r] = s[c];
+        }
+      }
+    }
+  }
+}
+
+void OceanFFT::transform(const Plan &p_plan, float *re, float *im) const {
+  int n = p_plan.n;
+  const int *pairs = p_plan.swap_pairs.data();
+  for (size_t i = 0; i < p_plan.swap_pairs.size(); i += 2) {
+    std::swap(re[pairs[i]], re[pairs[i + 1]]);
+    std::swap(im[pairs[i]], im[pairs[i + 1]]);
+  }
+
+  if (p_plan.leading_radix2) {
+    for (int k = 0; k < n; k += 2) {
+      float ur = re[k], ui = im[k];
+      re[k] = ur + re[k + 1];
+      im[k] = ui + im[k + 1];
+      re[k + 1] = ur - re[k + 1];
+      im[k + 1] = ui - im[k + 1];
+    }
+  }
+
+  for (size_t s = 0; s < p_plan.stage_q.size(); ++s) {
+    int q = p_plan.stage_q[s];
+    int o = p_plan.stage_offset[s];
+    select_kernel(simd_level, q)(re, im, n, q, &p_plan.w1_re[o],
+                                 &p_plan.w1_im[o], &p_plan.w2_re[o],
+                                 &p_plan.w2_im[o]);
+  }
+}
+
+const char *OceanFFT::get_name() const {
+  return parallel_for ? "Threaded" : "SIMD";
+}
+
+void OceanFFT::inverse_c2r_batch(float *const *spec_re, float *const *spec_im,
+                                 float *const *out, int p_count) {
+  int n = size;
+  int half = n / 2;
+  int stride = half + 1;
+  int field_size = stride * n;
+  if ((int)transposed_re.size() < field_size * p_count) {
+    transposed_re.resize(field_size * p_count);
+    transposed_im.resize(field_size * p_count);
+  }
+  float *t_re = transposed_re.data();
+  float *t_im = transposed_im.data();
+
+  // 1. Transpose so every kx column becomes a contiguous row of n
+  run_ranges(n, [&](int p_begin, int p_end) {
+    for (int f = 0; f < p_count; ++f) {
+      transpose_rows(spec_re[f], n, stride, t_re + f * field_size, p_begin,
+                     p_end);
+      transpose_rows(spec_im[f], n, stride, t_im + f * field_size, p_begin,
+                     p_end);
+    }
+  });
+
+  // 2. IFFT along kz, one contiguous row per kx
+  run_ranges(stride, [&](int p_begin, int p_end) {
+    for (int f = 0; f < p_count; ++f) {
+      float *f_re = t_re + f * field_size;
+      float *f_im = t_im + f * field_size;
+      for (int x = p_begin; x < p_end; ++x) {
+        transform(column_plan, f_re + x * n, f_im + x * n);
+      }
+    }
+  });
+
+  // 3. Transpose back to kz rows
+  run_ranges(stride, [&](int p_begin, int p_end) {
+    for (int f = 0; f < p_count; ++f) {
+      transpose_rows(t_re + f * field_size, stride, n, spec_re[f], p_begin,
+                     p_end);
+      transpose_rows(t_im + f * field_size, stride, n, spec_im[f], p_begin,
+                     p_end);
+    }
+  });
+
+  // 4. Row complex-to-real through one n/2 point complex IFFT per row,
+  //    packed in place over the first n/2 entries of the row:
+  //    Z[k] = (X[k] + conj(X[n/2 - k])) + i (X[k] - conj(X[n/2 - k])) W^k
+  //    Z[k] and Z[n/2 - k] read the same pair, so both are written together.
+  run_ranges(n, [&](int p_begin, int p_end) {
+    for (int f = 0; f < p_count; ++f) {
+      for (int z = p_begin; z < p_end; ++z) {
+        float *xr = spec_re[f] + z * stride;
+        float *xi = spec_im[f] + z * stride;
+        for (int k = 0; k <= half / 2; ++k) {
+          int kk = half - k;
+          float ar = xr[k], ai = xi[k];
+          float br = xr[kk], bi = xi[kk];
+
+          float sr = ar + br, si = ai - bi;
+          float dr = ar - br, di = ai + bi;
+          float tr = dr * pack_re[k] - di * pack_im[k];
+          float ti = dr * pack_im[k] + di * pack_re[k];
+          xr[k] = sr - ti;
+          xi[k] = si + tr;
+
+          if (kk != k && kk < half) {
+            // Same pair seen from n/2 - k: a and b swap roles
+            float sr2 = br + ar, si2 = bi - ai;
+            float dr2 = br - ar, di2 = bi + ai;
+            float tr2 = dr2 * pack_re[kk] - di2 * pack_im[kk];
+            float ti2 = dr2 * pack_im[kk] + di2 * pack_re[kk];
+            xr[kk] = sr2 - ti2;
+            xi[kk] = si2 + tr2;
+          }
+        }
+        transform(row_plan, xr, xi);
+        float *row_out = out[f] + z * n;
+        for (int m = 0; m < half; ++m) {
+          row_out[2 * m] = xr[m];
+          row_out[2 * m + 1] = xi[m];
+        }
+      }
+    }
+  });
+}
+
+void OceanReferenceFFT::transform(std::vector<std::complex<double>> &data,
+                                  int n) {
+  // Basic Cooley-Tukey, inverse sign, unnormalised
+  int log2n = 0;
+  while ((1 << log2n) < n)
+    log2n++;
+
+  for (int i = 0; i < n; ++i) {
+    int j = 0;
+    for (int b = 0; b < log2n; ++b) {
+      if (i & (1 << b))
+        j |= 1 << (log2n - 1 - b);
+    }
+    if (i < j)
+      std::swap(data[i], data[j]);
+  }
+
+  const double PI = 3.14159265358979323846;
+  for (int s = 1; s <= log2n; ++s) {
+    int m = 1 << s;
+    int m2 = m >> 1;
+    std::complex<double> wm = std::exp(std::complex<double>(0, 2.0 * PI / m));
+
+    for (int k = 0; k < n; k += m) {
+      std::complex<double> w = 1.0;
+      for (int j = 0; j < m2; ++j) {
+        std::complex<double> t = w * data[k + j + m2];
+        std::complex<double> u = data[k + j];
+        data[k + j] = u + t;
+        data[k + j + m2] = u - t;
+        w *= wm;
+      }
+    }
+  }
+}
+
+// Columns are transformed first; each row is then a 1D complex-to-real
+// transform, done as one n/2 point complex IFFT by packing even samples
+// into the real part and odd samples into the imaginary part.
+void OceanReferenceFFT::inverse_c2r_double(
+    std::vector<std::complex<double>> &spectrum,
+    std::vector<double> &out) const {
+  const double PI = 3.14159265358979323846;
+  int n = size;
+  int half = n / 2;
+  int stride = half + 1;
+
+  // 1. Column IFFT along kz, only for the stored kx columns
+  std::vector<std::complex<double>> col_data(n);
+  for (int x = 0; x < stride; ++x) {
+    for (int z = 0; z < n; ++z) {
+      col_data[z] = spectrum[z * stride + x];
+    }
+    transform(col_data, n);
+    for (int z = 0; z < n; ++z) {
+      spectrum[z * stride + x] = col_data[z];
+    }
+  }
+
+  // 2. Row complex-to-real. For X[k], k = 0..n/2 (Hermitian in k):
+  //    Z[k] = (X[k] + conj(X[n/2 - k])) + i * (X[k] - conj(X[n/2 - k])) * W^k
+  //    with W = exp(+2*pi*i / n); IFFT_{n/2}(Z)[m] = x[2m] + i * x[2m + 1]
+  std::vector<std::complex<double>> packed(half);
+  for (int z = 0; z < n; ++z) {
+    const std::complex<double> *row = &spectrum[z * stride];
+    for (int k = 0; k < half; ++k) {
+      std::complex<double> a = row[k];
+      std::complex<double> b = std::conj(row[half - k]);
+      std::complex<double> w =
+          std::exp(std::complex<double>(0, 2.0 * PI * k / n));
+      packed[k] = (a + b) + std::complex<double>(0, 1) * ((a - b) * w);
+    }
+    transform(packed, half);
+    for (int m = 0; m < half; ++m) {
+      out[z * n + 2 * m] = packed[m].real();
+      out[z * n + 2 * m + 1] = packed[m].imag();
+    }
+  }
+}
+
+void OceanReferenceFFT::inverse_c2r_batch(float *const *spec_re,
+                                          float *const *spec_im,
+                                          float *const *out, int p_count) {
+  int n = size;
+  int count = (n / 2 + 1) * n;
+  std::vector<std::complex<double>> spectrum(count);
+  std::vector<double> field(n * n);
+  for (int f = 0; f < p_count; ++f) {
+    for (int i = 0; i < count; ++i) {
+      spectrum[i] = std::complex<double>(spec_re[f][i], spec_im[f][i]);
+    }
+    inverse_c2r_double(spectrum, field);
+    for (int i = 0; i < n * n; ++i) {
+      out[f][i] = (float)field[i];
+    }
+  }
+}
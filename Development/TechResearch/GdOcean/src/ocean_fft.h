@@ -0,0 +1,127 @@
+#ifndef OCEAN_FFT_H
+#define OCEAN_FFT_H
+
+#include <complex>
+#include <functional>
+#include <vector>
+
+namespace gd_ocean {
+
+// Inverse transform for one n x n grid. The ocean only uses this
+// interface, so the implementation can be chosen at runtime.
+class OceanFFTPlan {
+public:
+    virtual ~OceanFFTPlan() {}
+
+    // Plans a 2D complex-to-real inverse for an n x n grid (n power of two).
+    virtual void setup(int p_size) = 0;
+    virtual int get_size() const = 0;
+    virtual const char *get_name() const = 0;
+
+    // Unnormalised 2D complex-to-real inverse transform of p_count
+    // independent fields. spec_re / spec_im hold the Hermitian half
+    // spectrum, kx = 0..n/2 for every kz row (row stride n/2 + 1), and are
+    // used as scratch. out receives n * n real samples per field, row-major.
+    virtual void inverse_c2r_batch(float *const *spec_re, float *const *spec_im, float *const *out, int p_count) = 0;
+    void inverse_c2r(float *spec_re, float *spec_im, float *out) { inverse_c2r_batch(&spec_re, &spec_im, &out, 1); }
+};
+
+// Textbook radix-2 Cooley-Tukey in double precision. Slow, but simple
+// enough to trust, so it is the baseline the other engines are checked
+// against.
+class OceanReferenceFFT : public OceanFFTPlan {
+public:
+    void setup(int p_size) override { size = p_size; }
+    int get_size() const override { return size; }
+    const char *get_name() const override { return "Reference"; }
+
+    void inverse_c2r_batch(float *const *spec_re, float *const *spec_im, float *const *out, int p_count) override;
+    // Same transform without the float round trip
+    void inverse_c2r_double(std::vector<std::complex<double>> &spectrum, std::vector<double> &out) const;
+
+private:
+    static void transform(std::vector<std::complex<double>> &data, int n);
+
+    int size = 0;
+};
+
+// Single precision FFT engine for the ocean height field.
+// Data is split into separate real / imaginary arrays (SoA) so butterflies
+// map directly onto SSE / AVX2 lanes. Stages are radix-4 (two radix-2
+// stages fused), with one leading radix-2 stage when log2(n) is odd.
+// The SIMD path is chosen once at runtime from the host CPU.
+// The 2D transform runs row transforms only; the column pass is turned
+// into a row pass with cache-blocked transposes, and every pass can be
+// split across worker threads through a ParallelFor hook.
+class OceanFFT : public OceanFFTPlan {
+public:
+    enum SimdLevel {
+        SIMD_SCALAR,
+        SIMD_SSE,
+        SIMD_AVX2,
+    };
+
+    // Runs p_job(i) for i in [0, p_count) and returns when all are done.
+    typedef std::function<void(int p_count, const std::function<void(int)> &p_job)> ParallelFor;
+
+    OceanFFT();
+
+    void setup(int p_size) override;
+    int get_size() const override { return size; }
+    // "SIMD", or "Threaded" with a ParallelFor
+    const char *get_name() const override;
+    SimdLevel get_simd_level() const { return simd_level; }
+
+    // Without a ParallelFor (or below MIN_PARALLEL_SIZE) all passes run on
+    // the calling thread.
+    void set_parallel_for(const ParallelFor &p_parallel_for, int p_worker_count);
+
+    // Every pass covers all fields before the next one starts.
+    void inverse_c2r_batch(float *const *spec_re, float *const *spec_im, float *const *out, int p_count) override;
+
+    static SimdLevel detect_simd_level();
+    static const char *get_simd_level_name(SimdLevel p_level);
+
+private:
+    // Radix-2/4 inverse plan for one transform length.
+    struct Plan {
+        int n = 0;
+        bool leading_radix2 = false;
+        std::vector<int> swap_pairs; // bit-reversal swaps, (i, j) with i < j
+        std::vector<int> stage_q;    // quarter block size of each radix-4 stage
+        std::vector<int> stage_offset;
+        // Per radix-4 stage twiddles, q entries each: w1 = e^{+i2pi j/2q},
+        // w2 = e^{+i2pi j/4q}
+        std::vector<float> w1_re, w1_im, w2_re, w2_im;
+
+        void build(int p_n);
+    };
+
+    void transform(const Plan &p_plan, float *re, float *im) const;
+    // Transposes source rows [p_row_begin, p_row_end) of a rows x cols
+    // matrix into dst (cols x rows) in TRANSPOSE_TILE square tiles.
+    static void transpose_rows(const float *src, int p_rows, int p_cols, float *dst, int p_row_begin, int p_row_end);
+    // Splits [0, p_items) into contiguous ranges and runs them in parallel.
+    void run_ranges(int p_items, const std::function<void(int, int)> &p_range_job) const;
+
+    static const int TRANSPOSE_TILE = 32;
+    // Below this size thread dispatch costs more than the transform
+    static const int MIN_PARALLEL_SIZE = 128;
+
+    int size = 0;
+    SimdLevel simd_level = SIMD_SCALAR;
+    Plan column_plan; // length n, along kz
+    Plan row_plan;    // length n/2, packed complex-to-real rows
+
+    ParallelFor parallel_for;
+    int worker_count = 1;
+
+    // e^{+i2pi k/n} for the complex-to-real row packing
+    std::vector<float> pack_re, pack_im;
+    // Spectra transposed to (n/2 + 1) rows of n, one row per kx, per field
+    std::vector<float> transposed_re, transposed_im;
+};
+
+} // namespace gd_ocean
+
+#endif
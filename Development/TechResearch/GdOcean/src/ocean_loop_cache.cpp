@@ -0,0 +1,252 @@
+#include "ocean_loop_cache.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace gd_ocean;
+
+namespace {
+
+#ifdef _WIN32
+std::wstring widen(const std::string &p_path) {
+  int count = MultiByteToWideChar(CP_UTF8, 0, p_path.c_str(), -1, nullptr, 0);
+  std::wstring wide(count > 0 ? count - 1 : 0, L'\0');
+  if (count > 1)
+    MultiByteToWideChar(CP_UTF8, 0, p_path.c_str(), -1, &wide[0], count);
+  return wide;
+}
+#endif
+
+FILE *open_for_write(const std::string &p_path) {
+#ifdef _WIN32
+  return _wfopen(widen(p_path).c_str(), L"wb");
+#else
+  return std::fopen(p_path.c_str(), "wb");
+#endif
+}
+
+bool replace_file(const std::string &p_from, const std::string &p_to) {
+#ifdef _WIN32
+  return MoveFileExW(widen(p_from).c_str(), widen(p_to).c_str(),
+                     MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+  return std::rename(p_from.c_str(), p_to.c_str()) == 0;
+#endif
+}
+
+} // namespace
+
+OceanLoopCache::~OceanLoopCache() { close(); }
+
+size_t OceanLoopCache::get_frame_bytes(uint32_t p_resolution,
+                                       uint32_t p_field_count) {
+  size_t texels = (size_t)p_resolution * p_resolution;
+  return p_field_count * (sizeof(float) + texels * sizeof(int16_t));
+}
+
+bool OceanLoopCache::open(const std::string &p_path, uint64_t p_hash) {
+  close();
+
+#ifdef _WIN32
+  HANDLE file = CreateFileW(widen(p_path).c_str(), GENERIC_READ,
+                            FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                            FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file == INVALID_HANDLE_VALUE)
+    return false;
+  LARGE_INTEGER file_size;
+  if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0) {
+    CloseHandle(file);
+    return false;
+  }
+  HANDLE mapping =
+      CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (!mapping) {
+    CloseHandle(file);
+    return false;
+  }
+  void *view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  if (!view) {
+    CloseHandle(mapping);
+    CloseHandle(file);
+    return false;
+  }
+  file_handle = file;
+  mapping_handle = mapping;
+  base = (const uint8_t *)view;
+  length = (size_t)file_size.QuadPart;
+#else
+  int fd = ::open(p_path.c_str(), O_RDONLY);
+  if (fd < 0)
+    return false;
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size == 0) {
+    ::close(fd);
+    return false;
+  }
+  void *view = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  // The mapping keeps the file alive
+  ::close(fd);
+  if (view == MAP_FAILED)
+    return false;
+  base = (const uint8_t *)view;
+  length = (size_t)st.st_size;
+#endif
+
+  FileHeader header;
+  if (length < sizeof(header)) {
+    close();
+    return false;
+  }
+  std::memcpy(&header, base, sizeof(header));
+  if (std::memcmp(header.magic, "GDOL", 4) != 0 || header.version != VERSION ||
+      header.hash != p_hash || header.frame_count == 0) {
+    close();
+    return false;
+  }
+
+  size_t offset = sizeof(header) + header.cascade_count * sizeof(CascadeInfo);
+  if (length < offset) {
+    close();
+    return false;
+  }
+  cascades.resize(header.cascade_count);
+  std::memcpy(cascades.data(), base + sizeof(header),
+              header.cascade_count * sizeof(CascadeInfo));
+  for (const CascadeInfo &info : cascades) {
+    cascade_offsets.push_back(offset);
+    offset += header.frame_count *
+              get_frame_bytes(info.resolution, header.field_count);
+  }
+  if (length < offset) {
+    close();
+    return false;
+  }
+
+  period = header.period;
+  frame_count = (int)header.frame_count;
+  field_count = (int)header.field_count;
+  return true;
+}
+
+void OceanLoopCache::close() {
+  if (base) {
+#ifdef _WIN32
+    UnmapViewOfFile(base);
+    CloseHandle((HANDLE)mapping_handle);
+    CloseHandle((HANDLE)file_handle);
+    mapping_handle = nullptr;
+    file_handle = nullptr;
+#else
+    munmap((void *)base, length);
+#endif
+  }
+  base = nullptr;
+  length = 0;
+  period = 0.0f;
+  frame_count = 0;
+  field_count = 0;
+  cascades.clear();
+  cascade_offsets.clear();
+}
+
+const uint8_t *OceanLoopCache::get_frame(int p_cascade, int p_frame) const {
+  const CascadeInfo &info = cascades[p_cascade];
+  return base + cascade_offsets[p_cascade] +
+         p_frame * get_frame_bytes(info.resolution, field_count);
+}
+
+float OceanLoopCache::get_scale(int p_cascade, int p_frame,
+                                int p_field) const {
+  float scale;
+  std::memcpy(&scale, get_frame(p_cascade, p_frame) + p_field * sizeof(float),
+              sizeof(float));
+  return scale;
+}
+
+const int16_t *OceanLoopCache::get_field(int p_cascade, int p_frame,
+                                         int p_field) const {
+  const CascadeInfo &info = cascades[p_cascade];
+  size_t texels = (size_t)info.resolution * info.resolution;
+  // The scale block keeps the int16 data 4-byte aligned
+  return (const int16_t *)(get_frame(p_cascade, p_frame) +
+                           field_count * sizeof(float) +
+                           p_field * texels * sizeof(int16_t));
+}
+
+bool OceanLoopCache::write(const std::string &p_path, uint64_t p_hash,
+                           float p_period, int p_frame_count,
+                           int p_field_count,
+                           const std::vector<CascadeInfo> &p_cascades,
+                           const FrameSource &p_source) {
+  // Written beside the target and moved over it when complete, so a
+  // mapping of the old file stays valid and a failed write leaves no
+  // partial cache behind
+  std::string temp_path = p_path + ".tmp";
+  FILE *file = open_for_write(temp_path);
+  if (!file)
+    return false;
+
+  FileHeader header;
+  std::memcpy(header.magic, "GDOL", 4);
+  header.version = VERSION;
+  header.hash = p_hash;
+  header.cascade_count = (uint32_t)p_cascades.size();
+  header.frame_count = (uint32_t)p_frame_count;
+  header.field_count = (uint32_t)p_field_count;
+  header.period = p_period;
+  bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1;
+  ok = ok && std::fwrite(p_cascades.data(), sizeof(CascadeInfo),
+                         p_cascades.size(), file) == p_cascades.size();
+
+  std::vector<float> values;
+  std::vector<float *> fields(p_field_count);
+  std::vector<float> scales(p_field_count);
+  std::vector<int16_t> quantised;
+  for (int c = 0; c < (int)p_cascades.size() && ok; ++c) {
+    size_t texels = (size_t)p_cascades[c].resolution * p_cascades[c].resolution;
+    values.resize(texels * p_field_count);
+    quantised.resize(texels * p_field_count);
+    for (int f = 0; f < p_field_count; ++f) {
+      fields[f] = values.data() + f * texels;
+    }
+
+    for (int frame = 0; frame < p_frame_count && ok; ++frame) {
+      ok = p_source(c, frame, fields.data());
+      if (!ok)
+        break;
+      for (int f = 0; f < p_field_count; ++f) {
+        float peak = 0.0f;
+        for (size_t i = 0; i < texels; ++i) {
+          peak = std::max(peak, std::abs(fields[f][i]));
+        }
+        scales[f] = peak > 0.0f ? peak / 32767.0f : 1.0f;
+        float inv = 1.0f / scales[f];
+        int16_t *dst = quantised.data() + f * texels;
+        for (size_t i = 0; i < texels; ++i) {
+          dst[i] = (int16_t)std::lrint(fields[f][i] * inv);
+        }
+      }
+      ok = std::fwrite(scales.data(), sizeof(float), p_field_count, file) ==
+               (size_t)p_field_count &&
+           std::fwrite(quantised.data(), sizeof(int16_t), quantised.size(),
+                       file) == quantised.size();
+    }
+  }
+
+  ok = std::fclose(file) == 0 && ok;
+  ok = ok && replace_file(temp_path, p_path);
+  if (!ok)
+    std::remove(temp_path.c_str());
+  return ok;
+}
@@ -0,0 +1,83 @@
+#ifndef OCEAN_LOOP_CACHE_H
+#define OCEAN_LOOP_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace gd_ocean {
+
+// Precomputed frames of a periodic ocean, stored as int16 with one scale
+// per field and frame and read through a read-only memory mapping, so a
+// cache written once is loaded without decoding.
+//
+// File layout (little endian):
+//   FileHeader
+//   CascadeInfo[cascade_count]
+//   per cascade, per frame: float scale[field_count],
+//                           int16 data[field_count][resolution^2]
+class OceanLoopCache {
+public:
+    struct CascadeInfo {
+        uint32_t resolution;
+        float size;
+    };
+
+    // Fills p_fields[field_count] (resolution^2 floats each) with frame
+    // p_frame of cascade p_cascade; returning false abandons the write.
+    typedef std::function<bool(int p_cascade, int p_frame, float *const *p_fields)> FrameSource;
+
+    OceanLoopCache() {}
+    ~OceanLoopCache();
+
+    // Maps p_path and checks it was written for p_hash; fails on a
+    // missing, truncated or stale file.
+    bool open(const std::string &p_path, uint64_t p_hash);
+    void close();
+    bool is_open() const { return base != nullptr; }
+
+    static bool write(const std::string &p_path, uint64_t p_hash, float p_period, int p_frame_count,
+            int p_field_count, const std::vector<CascadeInfo> &p_cascades, const FrameSource &p_source);
+
+    float get_period() const { return period; }
+    int get_frame_count() const { return frame_count; }
+    int get_cascade_count() const { return (int)cascades.size(); }
+    const CascadeInfo &get_cascade(int p_cascade) const { return cascades[p_cascade]; }
+    float get_scale(int p_cascade, int p_frame, int p_field) const;
+    const int16_t *get_field(int p_cascade, int p_frame, int p_field) const;
+
+private:
+    struct FileHeader {
+        char magic[4];
+        uint32_t version;
+        uint64_t hash;
+        uint32_t cascade_count;
+        uint32_t frame_count;
+        uint32_t field_count;
+        float period;
+    };
+
+    static const uint32_t VERSION = 1;
+
+    static size_t get_frame_bytes(uint32_t p_resolution, uint32_t p_field_count);
+    const uint8_t *get_frame(int p_cascade, int p_frame) const;
+
+    const uint8_t *base = nullptr;
+    size_t length = 0;
+#ifdef _WIN32
+    void *file_handle = nullptr;
+    void *mapping_handle = nullptr;
+#endif
+
+    float period = 0.0f;
+    int frame_count = 0;
+    int field_count = 0;
+    std::vector<CascadeInfo> cascades;
+    std::vector<size_t> cascade_offsets;
+};
+
+} // namespace gd_ocean
+
+#endif
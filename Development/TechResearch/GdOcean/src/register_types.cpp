@@ -2,19 +2,22 @@
 #include <godot_cpp/core/defs.hpp>
 #include <godot_cpp/godot.hpp>
 
-#include "managers/SimulationManager.h"
+#include "gd_ocean.h"
 
 using namespace godot;
+using namespace gd_ocean;
 
-void initialize_npc_module(ModuleInitializationLevel p_level) {
+void initialize_gd_ocean_module(ModuleInitializationLevel p_level) {
   if (p_level != MODULE_INITIALIZATION_LEVEL_SCENE) {
     return;
   }
 
-  ClassDB::register_class<SimulationManager>();
+  ClassDB::register_class<OceanWaveGenerator>();
+  ClassDB::register_class<BuoyancyProbe3D>();
+  ClassDB::register_class<BuoyancySystem>();
 }
 
-void uninitialize_npc_module(ModuleInitializationLevel p_level) {
+void uninitialize_gd_ocean_module(ModuleInitializationLevel p_level) {
   if (p_level != MODULE_INITIALIZATION_LEVEL_SCENE) {
     return;
   }
@@ -22,14 +25,14 @@ void uninitialize_npc_module(ModuleInitializationLevel p_level) {
 
 extern "C" {
 GDExtensionBool GDE_EXPORT
-npc_library_init(GDExtensionInterfaceGetProcAddress p_get_proc_address,
-                 const GDExtensionClassLibraryPtr p_library,
-                 GDExtensionInitialization *r_initialization) {
+gd_ocean_library_init(GDExtensionInterfaceGetProcAddress p_get_proc_address,
+                      const GDExtensionClassLibraryPtr p_library,
+                      GDExtensionInitialization *r_initialization) {
   godot::GDExtensionBinding::InitObject init_obj(p_get_proc_address, p_library,
                                                  r_initialization);
 
-  init_obj.register_initializer(initialize_npc_module);
-  init_obj.register_uninitializer(uninitialize_npc_module);
+  init_obj.register_initializer(initialize_gd_ocean_module);
+  init_obj.register_uninitializer(uninitialize_gd_ocean_module);
   init_obj.set_minimum_library_initialization_level(
       MODULE_INITIALIZATION_LEVEL_SCENE);
 
@@ -20,6 +20,9 @@ var output_texture: ViewportTexture
 # 衝擊點佇列（每幀最多 8 個）
 var _pending_impulses: Array[Vector4] = []
 var _center_world: Vector2 = Vector2.ZERO  # 模擬區域的世界中心
+# C++ OceanSplatter：衝擊直接寫進貼圖，每幀不限 8 個（無擴充時為 null）
+var _splatter: RefCounted = null
+var _impulse_texture: ImageTexture
 
 func _ready():
 	_create_viewport()
@@ -36,6 +39,9 @@ func add_impulse(world_pos: Vector3, strength: float = 0.5, radius_m: float = 0.
 	if uv.x < -0.1 or uv.x > 1.1 or uv.y < -0.1 or uv.y > 1.1:
 		return
 	var radius_uv = radius_m / WORLD_SIZE
+	if _splatter:
+		_splatter.splat(uv, strength, radius_uv)
+		return
 	_pending_impulses.append(Vector4(uv.x, uv.y, strength, radius_uv))
 
 ## 世界座標 → 模擬 UV [0,1]
@@ -66,6 +72,12 @@ func _create_viewport():
 	sim_material.set_shader_parameter("damping", damping)
 	sim_material.set_shader_parameter("wave_speed", wave_speed)
 	sim_material.set_shader_parameter("impulse_count", 0)
+	if ClassDB.class_exists("OceanSplatter"):
+		_splatter = ClassDB.instantiate("OceanSplatter")
+		_splatter.size = Vector2i(RESOLUTION, RESOLUTION)
+		_impulse_texture = _splatter.create_texture()
+		sim_material.set_shader_parameter("impulse_tex", _impulse_texture)
+		sim_material.set_shader_parameter("use_impulse_tex", true)
 	
 	sim_rect.material = sim_material
 	viewport.add_child(sim_rect)
@@ -79,6 +91,11 @@ func _update_center():
 	_center_world = Vector2(follow_target.global_position.x, follow_target.global_position.z)
 
 func _flush_impulses():
+	if _splatter:
+		# 上傳這幀的衝擊後清掉；沒有新衝擊的幀不會上傳
+		_splatter.update_texture(_impulse_texture)
+		_splatter.clear()
+		return
 	var count = mini(_pending_impulses.size(), 8)
 	
 	if count > 0:
@@ -60,6 +60,7 @@ enum EffectViewportQuality {Quarter = 0, Half = 1, Full = 2}
 @export var swe_fill_mode: float = 0.0  # ★ 0=normal ocean, 1=fill mode (only SWE areas visible)
 @export var swe_fill_threshold: float = 0.02
 @export var skip_obstacle_bake: bool = false  # ★ Skip obstacle raycasting entirely
+@export var native_obstacle_bake: bool = true  # ★ 有 C++ 擴充時以碰撞形狀光柵化取代射線（伺服器端建立的碰撞需關閉）
 
 @export_group("Environmental Effects")
 @export var rain_intensity: float = 0.0:
@@ -792,6 +793,8 @@ func _update_interaction_ripples() -> void:
 # ★ Kelvin Wake Source 追蹤系統
 var _kelvin_wake_sources: Array = []  # [{node: Node3D, strength: float, last_pos: Vector3}]
 const MAX_KELVIN_WAKES = 8
+# C++ OceanWakeField：同樣的尾流在 CPU 上解析計算，讓船隻受到尾流影響（無擴充時為 null）
+var _kelvin_wake_field: Node = null
 
 func register_kelvin_wake_source(node: Node3D, strength: float = 1.0) -> void:
 	for entry in _kelvin_wake_sources:
@@ -802,14 +805,38 @@ func register_kelvin_wake_source(node: Node3D, strength: float = 1.0) -> void:
 		"strength": strength,
 		"last_pos": node.global_position
 	})
+	if _kelvin_wake_field == null and ClassDB.class_exists("OceanWakeField"):
+		_kelvin_wake_field = ClassDB.instantiate("OceanWakeField")
+		_kelvin_wake_field.name = "KelvinWakeField"
+		add_child(_kelvin_wake_field)
+	if _kelvin_wake_field:
+		_kelvin_wake_field.register_source(node, strength)
 	print("[WaterManager] Registered Kelvin wake source: %s" % node.name)
 
 func unregister_kelvin_wake_source(node: Node3D) -> void:
+	if _kelvin_wake_field:
+		_kelvin_wake_field.unregister_source(node)
 	for i in range(_kelvin_wake_sources.size() - 1, -1, -1):
 		if _kelvin_wake_sources[i].node == node:
 			_kelvin_wake_sources.remove_at(i)
 			return
 
+## 批次查詢尾流高度（公尺）；沒有 C++ 擴充時全為 0
+func get_kelvin_wake_heights(positions: PackedVector3Array) -> PackedFloat32Array:
+	if _kelvin_wake_field:
+		return _kelvin_wake_field.get_wake_heights(positions)
+	var heights := PackedFloat32Array()
+	heights.resize(positions.size())
+	return heights
+
+## 批次查詢尾流造成的水面速度（m/s），可用於推動附近船隻
+func get_kelvin_wake_velocities(positions: PackedVector3Array) -> PackedVector3Array:
+	if _kelvin_wake_field:
+		return _kelvin_wake_field.get_wake_velocities(positions)
+	var velocities := PackedVector3Array()
+	velocities.resize(positions.size())
+	return velocities
+
 func _update_kelvin_wake_shader(mat: Material) -> void:
 	# 清理無效的 wake sources
 	for i in range(_kelvin_wake_sources.size() - 1, -1, -1):
@@ -877,6 +904,9 @@ func _update_kelvin_wake_shader(mat: Material) -> void:
 	
 	mat.set_shader_parameter("kelvin_wake_pos", pos_arr)
 	mat.set_shader_parameter("kelvin_wake_vel", vel_arr)
+	# 與 C++ 尾流場使用同一個最大長度，畫面與物理一致
+	if _kelvin_wake_field:
+		mat.set_shader_parameter("kelvin_wake_max_length", _kelvin_wake_field.max_wake_length)
 
 
 
@@ -1885,6 +1915,8 @@ func _load_compute_shader(path: String) -> RID:
 ## ★ 分幀版本：避免在單幀發射 grid_res² 條射線造成卡幀
 ## grid_res=128 時，總共 16384 條射線，每幀單位只處理 ROWS_PER_FRAME 行
 const BAKE_ROWS_PER_FRAME: int = 8  # 每幀處理 8 行 = 8*128 = 1024 條射線
+# C++ OceanObstacleRasterizer（無擴充或關閉 native_obstacle_bake 時為 null）
+var _obstacle_rasterizer: RefCounted = null
 
 func _bake_obstacles_async() -> void:
 	if not is_inside_tree(): return
@@ -1893,6 +1925,9 @@ func _bake_obstacles_async() -> void:
 	if skip_obstacle_bake:
 		print("[WaterManager] Obstacle baking skipped (skip_obstacle_bake=true)")
 		return
+	if native_obstacle_bake and ClassDB.class_exists("OceanObstacleRasterizer"):
+		_bake_obstacles_native()
+		return
 	
 	var space_state = world.direct_space_state
 	var obstacles_hit = 0
@@ -1963,6 +1998,60 @@ func _bake_obstacles_async() -> void:
 	var total_frames = ceili(float(grid_res) / BAKE_ROWS_PER_FRAME)
 	print("[WaterManager] Obstacles baked: %d (async, %d frames)" % [obstacles_hit, total_frames])
 
+## ★ C++ 版本：把場景中的碰撞形狀光柵化成障礙遮罩，單幀完成
+## 只收集 CollisionShape3D 節點；直接在 PhysicsServer 建立的碰撞不會被看到
+func _bake_obstacles_native() -> void:
+	if _obstacle_rasterizer == null:
+		_obstacle_rasterizer = ClassDB.instantiate("OceanObstacleRasterizer")
+	_obstacle_rasterizer.grid_res = grid_res
+	_obstacle_rasterizer.sea_size = sea_size
+	_obstacle_rasterizer.grid_transform = global_transform
+	_obstacle_rasterizer.clear_obstacles()
+	var shapes: Array[CollisionShape3D] = []
+	_collect_obstacle_shapes(get_tree().root, shapes)
+	for shape_node in shapes:
+		_obstacle_rasterizer.set_shape_obstacle(shape_node.get_instance_id(), shape_node.shape, shape_node.global_transform)
+	_obstacle_rasterizer.bake(true)
+	_upload_obstacle_mask()
+	
+	_setup_weather_pipeline()
+	print("[WaterManager] Obstacles baked: %d shapes (native)" % shapes.size())
+
+## 與射線版相同的篩選：只算物理體，排除水面與本節點底下的 StaticBody3D
+func _collect_obstacle_shapes(node: Node, result: Array[CollisionShape3D]) -> void:
+	if node is CollisionShape3D and not node.disabled and node.shape:
+		var body = node.get_parent()
+		var unsupported = node.shape is WorldBoundaryShape3D or node.shape is SeparationRayShape3D
+		if body is PhysicsBody3D and body.get_parent() != self and not unsupported:
+			result.append(node)
+	for child in node.get_children():
+		_collect_obstacle_shapes(child, result)
+
+## 障礙物移動、出現、消失或換了形狀後呼叫：只重新光柵化它新舊位置覆蓋的區塊，水面狀態保留
+## 只有移動時可傳 shape_changed = false，省去重新細分形狀
+func refresh_obstacle(shape_node: CollisionShape3D, shape_changed: bool = true) -> void:
+	if _obstacle_rasterizer == null or not sim_image: return
+	var id = shape_node.get_instance_id()
+	if not shape_node.is_inside_tree() or shape_node.disabled or not shape_node.shape:
+		_obstacle_rasterizer.remove_obstacle(id)
+	elif _obstacle_rasterizer.has_obstacle(id) and not shape_changed:
+		_obstacle_rasterizer.set_obstacle_transform(id, shape_node.global_transform)
+	else:
+		# 已存在時視為更新：舊的覆蓋區塊會一併重烘
+		_obstacle_rasterizer.set_shape_obstacle(id, shape_node.shape, shape_node.global_transform)
+	if _obstacle_rasterizer.bake() > 0:
+		_upload_obstacle_mask()
+
+## 把障礙遮罩寫進 sim_image 的 alpha（sim_image 每幀由 GPU 回讀，所以水面狀態不會被清掉）
+func _upload_obstacle_mask() -> void:
+	var data = _obstacle_rasterizer.apply_to_rgbaf(sim_image.get_data())
+	sim_image.set_data(grid_res, grid_res, false, Image.FORMAT_RGBAF, data)
+	if rd:
+		rd.texture_update(sim_texture_A, 0, data)
+		rd.texture_update(sim_texture_B, 0, data)
+	if visual_texture:
+		visual_texture.update(sim_image)
+
 func _setup_weather_pipeline():
 	if not rd: return
 	
@@ -66,6 +66,8 @@ void OceanBuoyancySampler3D::_bind_methods() {
 
   ClassDB::bind_method(D_METHOD("get_wave_height", "p_global_pos"),
                        &OceanBuoyancySampler3D::get_wave_height);
+  ClassDB::bind_method(D_METHOD("get_wave_heights", "p_global_positions"),
+                       &OceanBuoyancySampler3D::get_wave_heights_packed);
 }
 
 OceanBuoyancySampler3D::OceanBuoyancySampler3D() {}
@@ -116,6 +118,23 @@ float OceanBuoyancySampler3D::get_peak_sharpness() const {
 
 float OceanBuoyancySampler3D::get_wave_height(
     const Vector3 &p_global_pos) const {
+  float height;
+  get_wave_heights(&p_global_pos, 1, &height);
+  return height;
+}
+
+PackedFloat32Array OceanBuoyancySampler3D::get_wave_heights_packed(
+    const PackedVector3Array &p_positions) const {
+  PackedFloat32Array heights;
+  heights.resize(p_positions.size());
+  get_wave_heights(p_positions.ptr(), (int)p_positions.size(),
+                   heights.ptrw());
+  return heights;
+}
+
+void OceanBuoyancySampler3D::get_wave_heights(const Vector3 *p_positions,
+                                              int p_count,
+                                              float *r_heights) const {
   float wave_data[32] = {1.0f,  1.0f, 1.0f, 0.0f, 1.3f, 0.7f, 0.8f, 1.1f,
                          0.6f,  0.9f, 1.5f, 2.4f, 0.3f, 1.2f, 2.1f, -0.6f,
                          2.1f,  0.4f, 0.6f, 4.3f, 0.8f, 0.8f, 1.3f, -1.2f,
@@ -136,10 +155,11 @@ float OceanBuoyancySampler3D::get_wave_height(
   float base_angle = std::atan2(_wind_dir.y, _wind_dir.x);
   float safe_chaos = std::min(_wave_chaos, 0.3f);
 
-  float heightmap_y_disp = 0.0f;
   const float PI = 3.14159265358979323846f;
   float t = _physics_time;
 
+  // Per wave: direction, wavenumber, phase offset at t and amplitude
+  float dir_x[8], dir_z[8], wave_k[8], phase[8], amplitude[8];
   for (int i = 0; i < 8; i++) {
     int idx = i * 4;
     float w_len = wave_data[idx] * _wave_length;
@@ -151,27 +171,41 @@ float OceanBuoyancySampler3D::get_wave_height(
     float w_speed = wave_data[idx + 2];
     float w_angle = base_angle + wave_data[idx + 3] * safe_chaos;
 
-    Vector2 d = Vector2(std::cos(w_angle), std::sin(w_angle));
-
     float k = 2.0f * PI / w_len;
     float c = std::sqrt(9.81f / k) * w_speed;
-    float f = k * (d.dot(Vector2(p_global_pos.x, p_global_pos.z)) - c * t);
-    float a = w_steep / k;
-
-    float h = std::sin(f);
-    if (_peak_sharpness != 1.0f) {
-      float s = h * 0.5f + 0.5f;
-      h = std::pow(std::max(s, 0.001f), _peak_sharpness) * 2.0f - 1.0f;
+    dir_x[i] = std::cos(w_angle);
+    dir_z[i] = std::sin(w_angle);
+    wave_k[i] = k;
+    phase[i] = c * t;
+    amplitude[i] = w_steep / k;
+  }
+  bool sharpen = _peak_sharpness != 1.0f;
+  // Same gate as the shader: any chaos, including negative, once there is
+  // wind
+  bool add_noise = _wind_strength > 0.001f;
+  float noise_scale = _wind_strength * safe_chaos;
+
+  for (int p = 0; p < p_count; p++) {
+    float x = p_positions[p].x;
+    float z = p_positions[p].z;
+    float heightmap_y_disp = 0.0f;
+
+    for (int i = 0; i < 8; i++) {
+      float f = wave_k[i] * (dir_x[i] * x + dir_z[i] * z - phase[i]);
+      float h = std::sin(f);
+      if (sharpen) {
+        float s = h * 0.5f + 0.5f;
+        h = std::pow(std::max(s, 0.001f), _peak_sharpness) * 2.0f - 1.0f;
+      }
+      heightmap_y_disp += amplitude[i] * h;
     }
 
-    heightmap_y_disp += a * h;
-  }
+    if (add_noise) {
+      float noise = std::sin(x * 2.0f + t) * std::cos(z * 2.0f - t * 0.5f) *
+                    0.2f;
+      heightmap_y_disp += noise * noise_scale;
+    }
 
-  if (_wind_strength > 0.001f) {
-    float noise = std::sin(p_global_pos.x * 2.0f + t) *
-                  std::cos(p_global_pos.z * 2.0f - t * 0.5f) * 0.2f;
-    heightmap_y_disp += noise * _wind_strength * safe_chaos;
+    r_heights[p] = heightmap_y_disp;
   }
-
-  return heightmap_y_disp;
 }
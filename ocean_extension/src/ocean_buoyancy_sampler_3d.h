@@ -3,6 +3,8 @@
 
 #include <godot_cpp/classes/node3d.hpp>
 #include <godot_cpp/core/class_db.hpp>
+#include <godot_cpp/variant/packed_float32_array.hpp>
+#include <godot_cpp/variant/packed_vector3_array.hpp>
 #include <godot_cpp/variant/vector2.hpp>
 #include <godot_cpp/variant/vector3.hpp>
 
@@ -51,6 +53,12 @@ public:
   float get_peak_sharpness() const;
 
   float get_wave_height(const Vector3 &p_global_pos) const;
+  // Same heights for p_count points; the per-wave terms are set up once
+  // for the whole batch
+  void get_wave_heights(const Vector3 *p_positions, int p_count,
+                        float *r_heights) const;
+  PackedFloat32Array
+  get_wave_heights_packed(const PackedVector3Array &p_positions) const;
 
   void _process(double delta) override;
 };
@@ -0,0 +1,331 @@
+#include "ocean_flotsam_3d.h"
+#include "ocean_buoyancy_sampler_3d.h"
+#include <algorithm>
+#include <cmath>
+#include <godot_cpp/classes/engine.hpp>
+#include <godot_cpp/classes/rendering_server.hpp>
+#include <godot_cpp/core/class_db.hpp>
+
+using namespace godot;
+
+void OceanFlotsam3D::_bind_methods() {
+  ClassDB::bind_method(D_METHOD("spawn", "p_position", "p_velocity"),
+                       &OceanFlotsam3D::spawn, DEFVAL(Vector3()));
+  ClassDB::bind_method(D_METHOD("spawn_batch", "p_positions"),
+                       &OceanFlotsam3D::spawn_batch);
+  ClassDB::bind_method(D_METHOD("clear"), &OceanFlotsam3D::clear);
+  ClassDB::bind_method(D_METHOD("get_particle_count"),
+                       &OceanFlotsam3D::get_particle_count);
+
+  ClassDB::bind_method(D_METHOD("get_sampler"), &OceanFlotsam3D::get_sampler);
+  ClassDB::bind_method(D_METHOD("set_sampler", "p_path"),
+                       &OceanFlotsam3D::set_sampler);
+  ClassDB::add_property("OceanFlotsam3D",
+                        PropertyInfo(Variant::NODE_PATH, "sampler",
+                                     PROPERTY_HINT_NODE_PATH_VALID_TYPES,
+                                     "OceanBuoyancySampler3D"),
+                        "set_sampler", "get_sampler");
+
+  ClassDB::bind_method(D_METHOD("get_multimesh"),
+                       &OceanFlotsam3D::get_multimesh);
+  ClassDB::bind_method(D_METHOD("set_multimesh", "p_multimesh"),
+                       &OceanFlotsam3D::set_multimesh);
+  ClassDB::add_property("OceanFlotsam3D",
+                        PropertyInfo(Variant::OBJECT, "multimesh",
+                                     PROPERTY_HINT_RESOURCE_TYPE, "MultiMesh"),
+                        "set_multimesh", "get_multimesh");
+
+  ClassDB::bind_method(D_METHOD("get_max_particles"),
+                       &OceanFlotsam3D::get_max_particles);
+  ClassDB::bind_method(D_METHOD("set_max_particles", "p_count"),
+                       &OceanFlotsam3D::set_max_particles);
+  ClassDB::add_property("OceanFlotsam3D",
+                        PropertyInfo(Variant::INT, "max_particles"),
+                        "set_max_particles", "get_max_particles");
+
+  ClassDB::bind_method(D_METHOD("get_buoyancy"), &OceanFlotsam3D::get_buoyancy);
+  ClassDB::bind_method(D_METHOD("set_buoyancy", "p_buoyancy"),
+                       &OceanFlotsam3D::set_buoyancy);
+  ClassDB::add_property("OceanFlotsam3D",
+                        PropertyInfo(Variant::FLOAT, "buoyancy"),
+                        "set_buoyancy", "get_buoyancy");
+
+  ClassDB::bind_method(D_METHOD("get_drag"), &OceanFlotsam3D::get_drag);
+  ClassDB::bind_method(D_METHOD("set_drag", "p_drag"),
+                       &OceanFlotsam3D::set_drag);
+  ClassDB::add_property("OceanFlotsam3D", PropertyInfo(Variant::FLOAT, "drag"),
+                        "set_drag", "get_drag");
+
+  ClassDB::bind_method(D_METHOD("get_wind_drift"),
+                       &OceanFlotsam3D::get_wind_drift);
+  ClassDB::bind_method(D_METHOD("set_wind_drift", "p_drift"),
+                       &OceanFlotsam3D::set_wind_drift);
+  ClassDB::add_property("OceanFlotsam3D",
+                        PropertyInfo(Variant::FLOAT, "wind_drift"),
+                        "set_wind_drift", "get_wind_drift");
+
+  ClassDB::bind_method(D_METHOD("get_current"), &OceanFlotsam3D::get_current);
+  ClassDB::bind_method(D_METHOD("set_current", "p_current"),
+                       &OceanFlotsam3D::set_current);
+  ClassDB::add_property("OceanFlotsam3D",
+                        PropertyInfo(Variant::VECTOR2, "current"),
+                        "set_current", "get_current");
+
+  ClassDB::bind_method(D_METHOD("get_lifetime"), &OceanFlotsam3D::get_lifetime);
+  ClassDB::bind_method(D_METHOD("set_lifetime", "p_lifetime"),
+                       &OceanFlotsam3D::set_lifetime);
+  ClassDB::add_property("OceanFlotsam3D",
+                        PropertyInfo(Variant::FLOAT, "lifetime"),
+                        "set_lifetime", "get_lifetime");
+
+  ClassDB::bind_method(D_METHOD("get_sink_time"),
+                       &OceanFlotsam3D::get_sink_time);
+  ClassDB::bind_method(D_METHOD("set_sink_time", "p_time"),
+                       &OceanFlotsam3D::set_sink_time);
+  ClassDB::add_property("OceanFlotsam3D",
+                        PropertyInfo(Variant::FLOAT, "sink_time"),
+                        "set_sink_time", "get_sink_time");
+}
+
+OceanFlotsam3D::OceanFlotsam3D() {}
+OceanFlotsam3D::~OceanFlotsam3D() {}
+
+void OceanFlotsam3D::_notification(int p_what) {
+  if (p_what == NOTIFICATION_READY) {
+    _resolve_sampler();
+    _sync_multimesh();
+  }
+}
+
+void OceanFlotsam3D::_resolve_sampler() {
+  _sampler = nullptr;
+  if (!_sampler_path.is_empty() && is_inside_tree()) {
+    _sampler = Object::cast_to<OceanBuoyancySampler3D>(
+        get_node_or_null(_sampler_path));
+  }
+}
+
+void OceanFlotsam3D::_sync_multimesh() {
+  _buffer.resize(_max_particles * 12);
+  if (_multimesh.is_null()) {
+    return;
+  }
+  if (_multimesh->get_instance_count() != _max_particles ||
+      _multimesh->get_transform_format() != MultiMesh::TRANSFORM_3D ||
+      _multimesh->is_using_colors() || _multimesh->is_using_custom_data()) {
+    // The format can only change while the MultiMesh is empty. The buffer
+    // written each frame is 12 floats per instance, transform only.
+    _multimesh->set_instance_count(0);
+    _multimesh->set_transform_format(MultiMesh::TRANSFORM_3D);
+    _multimesh->set_use_colors(false);
+    _multimesh->set_use_custom_data(false);
+    _multimesh->set_instance_count(_max_particles);
+  }
+}
+
+void OceanFlotsam3D::_remove_particle(int p_index) {
+  // Swap with the last particle; order does not matter
+  for (std::vector<float> *array : {&_pos_x, &_pos_y, &_pos_z, &_vel_x,
+                                    &_vel_y, &_vel_z, &_age, &_yaw}) {
+    (*array)[p_index] = array->back();
+    array->pop_back();
+  }
+}
+
+void OceanFlotsam3D::_process(double delta) {
+  if (Engine::get_singleton()->is_editor_hint()) {
+    return;
+  }
+
+  // 1. Drop particles that have finished sinking. Walking backwards keeps
+  //    the swapped-in particle out of the unvisited range.
+  float max_age = _lifetime + _sink_time;
+  for (int i = (int)_age.size() - 1; i >= 0; i--) {
+    if (_age[i] >= max_age) {
+      _remove_particle(i);
+    }
+  }
+
+  int count = (int)_pos_x.size();
+  if (count > 0 && _sampler) {
+    // 2. Water height at every particle and at two neighbours for the
+    //    slope, all in one batch
+    _sample_points.resize(count * 3);
+    _heights.resize(count * 3);
+    for (int i = 0; i < count; i++) {
+      _sample_points[i] = Vector3(_pos_x[i], 0.0f, _pos_z[i]);
+      _sample_points[count + i] =
+          Vector3(_pos_x[i] + _tilt_probe, 0.0f, _pos_z[i]);
+      _sample_points[count * 2 + i] =
+          Vector3(_pos_x[i], 0.0f, _pos_z[i] + _tilt_probe);
+    }
+    _sampler->get_wave_heights(_sample_points.data(), count * 3,
+                               _heights.data());
+
+    // 3. Integrate. Drag relaxes the velocity towards the water's drift
+    //    with an exact exponential, so long frames stay stable.
+    const float GRAVITY = 9.81f;
+    float dt = (float)delta;
+    float damp = std::exp(-_drag * dt);
+    Vector2 wind = _sampler->get_wind_dir();
+    if (wind.length_squared() > 0.0f) {
+      wind = wind.normalized();
+    }
+    wind *= _sampler->get_wind_strength() * _wind_drift;
+    float drift_x = wind.x + _current.x;
+    float drift_z = wind.y + _current.y;
+
+    for (int i = 0; i < count; i++) {
+      float depth = _heights[i] - _pos_y[i];
+      float lift = 0.0f;
+      if (depth > 0.0f) {
+        // Full buoyancy while alive, fading to nothing over _sink_time
+        float afloat = 1.0f;
+        if (_age[i] > _lifetime) {
+          afloat = _sink_time > 0.0f
+                       ? std::max(0.0f, 1.0f - (_age[i] - _lifetime) /
+                                                   _sink_time)
+                       : 0.0f;
+        }
+        lift = _buoyancy * depth * afloat;
+      }
+      _vel_y[i] += (lift - GRAVITY) * dt;
+      if (depth > 0.0f) {
+        _vel_x[i] = drift_x + (_vel_x[i] - drift_x) * damp;
+        _vel_z[i] = drift_z + (_vel_z[i] - drift_z) * damp;
+        _vel_y[i] *= damp;
+      }
+      _pos_x[i] += _vel_x[i] * dt;
+      _pos_y[i] += _vel_y[i] * dt;
+      _pos_z[i] += _vel_z[i] * dt;
+      _age[i] += dt;
+    }
+  }
+
+  if (_multimesh.is_null()) {
+    return;
+  }
+
+  // 4. Transforms straight into the MultiMesh buffer: rows of the 3x4
+  //    matrix, the basis columns being the yawed tangent, the surface
+  //    normal and their cross product
+  float *buffer = _buffer.ptrw();
+  bool tilted = count > 0 && _sampler;
+  for (int i = 0; i < count; i++) {
+    Vector3 normal(0.0f, 1.0f, 0.0f);
+    if (tilted) {
+      float inv = 1.0f / _tilt_probe;
+      normal = Vector3(-(_heights[count + i] - _heights[i]) * inv, 1.0f,
+                       -(_heights[count * 2 + i] - _heights[i]) * inv)
+                   .normalized();
+    }
+    Vector3 tangent(std::cos(_yaw[i]), 0.0f, std::sin(_yaw[i]));
+    Vector3 x_axis = (tangent - normal * tangent.dot(normal)).normalized();
+    Vector3 z_axis = x_axis.cross(normal);
+
+    float *m = buffer + i * 12;
+    m[0] = x_axis.x;
+    m[1] = normal.x;
+    m[2] = z_axis.x;
+    m[3] = _pos_x[i];
+    m[4] = x_axis.y;
+    m[5] = normal.y;
+    m[6] = z_axis.y;
+    m[7] = _pos_y[i];
+    m[8] = x_axis.z;
+    m[9] = normal.z;
+    m[10] = z_axis.z;
+    m[11] = _pos_z[i];
+  }
+
+  RenderingServer *rs = RenderingServer::get_singleton();
+  RID rid = _multimesh->get_rid();
+  rs->multimesh_set_buffer(rid, _buffer);
+  rs->multimesh_set_visible_instances(rid, count);
+}
+
+bool OceanFlotsam3D::spawn(const Vector3 &p_position,
+                           const Vector3 &p_velocity) {
+  if ((int)_pos_x.size() >= _max_particles) {
+    return false;
+  }
+  _pos_x.push_back(p_position.x);
+  _pos_y.push_back(p_position.y);
+  _pos_z.push_back(p_position.z);
+  _vel_x.push_back(p_velocity.x);
+  _vel_y.push_back(p_velocity.y);
+  _vel_z.push_back(p_velocity.z);
+  _age.push_back(0.0f);
+  // Golden angle steps spread headings without a random generator
+  _yaw.push_back(std::fmod(_spawn_count * 2.39996323f, 6.28318531f));
+  _spawn_count++;
+  return true;
+}
+
+int OceanFlotsam3D::spawn_batch(const PackedVector3Array &p_positions) {
+  int spawned = 0;
+  for (int i = 0; i < (int)p_positions.size(); i++) {
+    if (!spawn(p_positions[i], Vector3())) {
+      break;
+    }
+    spawned++;
+  }
+  return spawned;
+}
+
+void OceanFlotsam3D::clear() {
+  for (std::vector<float> *array :
+       {&_pos_x, &_pos_y, &_pos_z, &_vel_x, &_vel_y, &_vel_z, &_age, &_yaw}) {
+    array->clear();
+  }
+  if (_multimesh.is_valid()) {
+    RenderingServer::get_singleton()->multimesh_set_visible_instances(
+        _multimesh->get_rid(), 0);
+  }
+}
+
+int OceanFlotsam3D::get_particle_count() const { return (int)_pos_x.size(); }
+
+void OceanFlotsam3D::set_sampler(const NodePath &p_path) {
+  _sampler_path = p_path;
+  _resolve_sampler();
+}
+NodePath OceanFlotsam3D::get_sampler() const { return _sampler_path; }
+
+void OceanFlotsam3D::set_multimesh(const Ref<MultiMesh> &p_multimesh) {
+  _multimesh = p_multimesh;
+  _sync_multimesh();
+}
+Ref<MultiMesh> OceanFlotsam3D::get_multimesh() const { return _multimesh; }
+
+void OceanFlotsam3D::set_max_particles(int p_count) {
+  _max_particles = std::max(p_count, 1);
+  if ((int)_pos_x.size() > _max_particles) {
+    for (std::vector<float> *array : {&_pos_x, &_pos_y, &_pos_z, &_vel_x,
+                                      &_vel_y, &_vel_z, &_age, &_yaw}) {
+      array->resize(_max_particles);
+    }
+  }
+  _sync_multimesh();
+}
+int OceanFlotsam3D::get_max_particles() const { return _max_particles; }
+
+void OceanFlotsam3D::set_buoyancy(float p_buoyancy) { _buoyancy = p_buoyancy; }
+float OceanFlotsam3D::get_buoyancy() const { return _buoyancy; }
+
+void OceanFlotsam3D::set_drag(float p_drag) { _drag = p_drag; }
+float OceanFlotsam3D::get_drag() const { return _drag; }
+
+void OceanFlotsam3D::set_wind_drift(float p_drift) { _wind_drift = p_drift; }
+float OceanFlotsam3D::get_wind_drift() const { return _wind_drift; }
+
+void OceanFlotsam3D::set_current(const Vector2 &p_current) {
+  _current = p_current;
+}
+Vector2 OceanFlotsam3D::get_current() const { return _current; }
+
+void OceanFlotsam3D::set_lifetime(float p_lifetime) { _lifetime = p_lifetime; }
+float OceanFlotsam3D::get_lifetime() const { return _lifetime; }
+
+void OceanFlotsam3D::set_sink_time(float p_time) { _sink_time = p_time; }
+float OceanFlotsam3D::get_sink_time() const { return _sink_time; }
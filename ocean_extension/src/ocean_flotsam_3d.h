@@ -0,0 +1,113 @@
+#ifndef OCEAN_FLOTSAM_3D_H
+#define OCEAN_FLOTSAM_3D_H
+
+#include <godot_cpp/classes/multi_mesh.hpp>
+#include <godot_cpp/classes/node3d.hpp>
+#include <godot_cpp/core/class_db.hpp>
+#include <godot_cpp/variant/node_path.hpp>
+#include <godot_cpp/variant/packed_float32_array.hpp>
+#include <godot_cpp/variant/packed_vector3_array.hpp>
+#include <godot_cpp/variant/vector2.hpp>
+#include <godot_cpp/variant/vector3.hpp>
+
+#include <vector>
+
+namespace godot {
+
+class OceanBuoyancySampler3D;
+
+// Purely visual floating debris. Particles live in flat arrays, float on
+// the Gerstner surface of an OceanBuoyancySampler3D, drift with wind and
+// current, and sink once their lifetime is over. Every frame their
+// transforms are written straight into the MultiMesh buffer; there are no
+// per-particle nodes or physics bodies.
+//
+// Positions are simulated and written in world space, whatever this
+// node's own transform is. The MultiMeshInstance3D that draws the
+// MultiMesh must therefore sit at the identity (e.g. top_level with a
+// default transform), or every particle is offset by its transform.
+class OceanFlotsam3D : public Node3D {
+  GDCLASS(OceanFlotsam3D, Node3D)
+
+private:
+  NodePath _sampler_path;
+  OceanBuoyancySampler3D *_sampler = nullptr;
+  Ref<MultiMesh> _multimesh;
+
+  int _max_particles = 1024;
+  float _buoyancy = 20.0f;   // m/s^2 per metre of depth
+  float _drag = 2.0f;        // 1/s, towards the water's drift velocity
+  float _wind_drift = 0.03f; // share of the wind strength, in m/s
+  Vector2 _current = Vector2(0.0f, 0.0f);
+  float _lifetime = 60.0f;
+  float _sink_time = 5.0f; // buoyancy fades out over this after lifetime
+  // Surface slope is taken from heights this far apart
+  float _tilt_probe = 0.5f;
+
+  // Particles, one entry each
+  std::vector<float> _pos_x, _pos_y, _pos_z;
+  std::vector<float> _vel_x, _vel_y, _vel_z;
+  std::vector<float> _age;
+  std::vector<float> _yaw;
+  int _spawn_count = 0;
+
+  // Scratch for the batched height query, kept between frames: every
+  // particle, then the same points offset along x and along z
+  std::vector<Vector3> _sample_points;
+  std::vector<float> _heights;
+  PackedFloat32Array _buffer;
+
+  void _resolve_sampler();
+  // Allocates the MultiMesh for _max_particles 3D transforms
+  void _sync_multimesh();
+  void _remove_particle(int p_index);
+
+protected:
+  static void _bind_methods();
+  void _notification(int p_what);
+
+public:
+  OceanFlotsam3D();
+  ~OceanFlotsam3D();
+
+  void _process(double delta) override;
+
+  // False once _max_particles are alive
+  bool spawn(const Vector3 &p_position, const Vector3 &p_velocity);
+  // Returns how many were spawned
+  int spawn_batch(const PackedVector3Array &p_positions);
+  void clear();
+  int get_particle_count() const;
+
+  void set_sampler(const NodePath &p_path);
+  NodePath get_sampler() const;
+
+  // Instances carry world-space transforms; draw it at the identity
+  void set_multimesh(const Ref<MultiMesh> &p_multimesh);
+  Ref<MultiMesh> get_multimesh() const;
+
+  void set_max_particles(int p_count);
+  int get_max_particles() const;
+
+  void set_buoyancy(float p_buoyancy);
+  float get_buoyancy() const;
+
+  void set_drag(float p_drag);
+  float get_drag() const;
+
+  void set_wind_drift(float p_drift);
+  float get_wind_drift() const;
+
+  void set_current(const Vector2 &p_current);
+  Vector2 get_current() const;
+
+  void set_lifetime(float p_lifetime);
+  float get_lifetime() const;
+
+  void set_sink_time(float p_time);
+  float get_sink_time() const;
+};
+
+} // namespace godot
+
+#endif
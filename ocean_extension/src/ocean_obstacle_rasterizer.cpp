@@ -0,0 +1,693 @@
+#include "ocean_obstacle_rasterizer.h"
+#include <algorithm>
+#include <cmath>
+#include <godot_cpp/classes/box_shape3d.hpp>
+#include <godot_cpp/classes/capsule_shape3d.hpp>
+#include <godot_cpp/classes/concave_polygon_shape3d.hpp>
+#include <godot_cpp/classes/convex_polygon_shape3d.hpp>
+#include <godot_cpp/classes/cylinder_shape3d.hpp>
+#include <godot_cpp/classes/height_map_shape3d.hpp>
+#include <godot_cpp/classes/sphere_shape3d.hpp>
+#include <godot_cpp/classes/worker_thread_pool.hpp>
+#include <godot_cpp/core/class_db.hpp>
+#include <godot_cpp/variant/callable_method_pointer.hpp>
+#include <limits>
+
+using namespace godot;
+
+namespace {
+
+const int TILE_SIZE = 16;
+// Tessellation of spheres, capsules and cylinders
+const int REVOLVE_SEGMENTS = 16;
+const int HEMISPHERE_RINGS = 4;
+
+const float NO_SURFACE = -std::numeric_limits<float>::infinity();
+
+void add_triangle(std::vector<Vector3> &r_out, const Vector3 &p_a,
+                  const Vector3 &p_b, const Vector3 &p_c) {
+  r_out.push_back(p_a);
+  r_out.push_back(p_b);
+  r_out.push_back(p_c);
+}
+
+void add_box(std::vector<Vector3> &r_out, const Vector3 &p_size) {
+  Vector3 e = p_size * 0.5f;
+  Vector3 c[8];
+  for (int i = 0; i < 8; i++) {
+    c[i] = Vector3(i & 1 ? e.x : -e.x, i & 2 ? e.y : -e.y, i & 4 ? e.z : -e.z);
+  }
+  // Two triangles per face, as corner indices
+  static const int FACES[6][4] = {{0, 1, 3, 2}, {4, 6, 7, 5}, {0, 4, 5, 1},
+                                  {2, 3, 7, 6}, {0, 2, 6, 4}, {1, 5, 7, 3}};
+  for (const int *f : FACES) {
+    add_triangle(r_out, c[f[0]], c[f[1]], c[f[2]]);
+    add_triangle(r_out, c[f[0]], c[f[2]], c[f[3]]);
+  }
+}
+
+// Surface of revolution about Y through a (radius, y) profile, top to
+// bottom. Rings of zero radius give degenerate triangles, which the
+// rasterizer skips.
+void add_revolved(std::vector<Vector3> &r_out,
+                  const std::vector<Vector2> &p_profile) {
+  for (size_t ring = 0; ring + 1 < p_profile.size(); ring++) {
+    const Vector2 &a = p_profile[ring];
+    const Vector2 &b = p_profile[ring + 1];
+    for (int s = 0; s < REVOLVE_SEGMENTS; s++) {
+      float t0 = (float)Math_TAU * s / REVOLVE_SEGMENTS;
+      float t1 = (float)Math_TAU * (s + 1) / REVOLVE_SEGMENTS;
+      Vector3 a0(a.x * std::cos(t0), a.y, a.x * std::sin(t0));
+      Vector3 a1(a.x * std::cos(t1), a.y, a.x * std::sin(t1));
+      Vector3 b0(b.x * std::cos(t0), b.y, b.x * std::sin(t0));
+      Vector3 b1(b.x * std::cos(t1), b.y, b.x * std::sin(t1));
+      add_triangle(r_out, a0, b0, b1);
+      add_triangle(r_out, a0, b1, a1);
+    }
+  }
+}
+
+// Quarter circle of radius p_radius around p_center_y, from the pole
+// towards the equator; p_sign 1 for the top, -1 for the bottom
+void add_hemisphere_profile(std::vector<Vector2> &r_profile, float p_radius,
+                            float p_center_y, float p_sign) {
+  for (int i = 0; i <= HEMISPHERE_RINGS; i++) {
+    float angle = (float)Math_PI * 0.5f * i / HEMISPHERE_RINGS;
+    r_profile.push_back(Vector2(p_radius * std::sin(angle),
+                                p_center_y + p_sign * p_radius *
+                                                 std::cos(angle)));
+  }
+}
+
+// Fan over the 2D hull of points lying in the plane through p_origin
+// with normal p_normal (monotone chain on two in-plane axes)
+void add_planar_hull(std::vector<Vector3> &r_out, const Vector3 *p_points,
+                     int p_count, const Vector3 &p_normal) {
+  // In-plane axes, avoiding the normal's dominant component
+  Vector3 n_abs(std::abs(p_normal.x), std::abs(p_normal.y),
+                std::abs(p_normal.z));
+  Vector3 other = n_abs.x <= n_abs.y && n_abs.x <= n_abs.z ? Vector3(1, 0, 0)
+                  : n_abs.y <= n_abs.z                     ? Vector3(0, 1, 0)
+                                                           : Vector3(0, 0, 1);
+  Vector3 u = p_normal.cross(other).normalized();
+  Vector3 v = p_normal.cross(u);
+  std::vector<std::pair<Vector2, int>> sorted(p_count);
+  for (int i = 0; i < p_count; i++) {
+    sorted[i] = {Vector2(u.dot(p_points[i]), v.dot(p_points[i])), i};
+  }
+  std::sort(sorted.begin(), sorted.end(),
+            [](const std::pair<Vector2, int> &p_a,
+               const std::pair<Vector2, int> &p_b) {
+              return p_a.first.x < p_b.first.x ||
+                     (p_a.first.x == p_b.first.x && p_a.first.y < p_b.first.y);
+            });
+  auto turn = [&](int p_o, int p_a, int p_b) {
+    Vector2 a = sorted[p_a].first - sorted[p_o].first;
+    Vector2 b = sorted[p_b].first - sorted[p_o].first;
+    return a.x * b.y - a.y * b.x;
+  };
+  std::vector<int> hull;
+  for (int pass = 0; pass < 2; pass++) {
+    size_t base = hull.size();
+    for (int k = 0; k < p_count; k++) {
+      int i = pass == 0 ? k : p_count - 1 - k;
+      while (hull.size() >= base + 2 &&
+             turn(hull[hull.size() - 2], hull.back(), i) <= 0.0f) {
+        hull.pop_back();
+      }
+      hull.push_back(i);
+    }
+    hull.pop_back(); // the first point of the other chain
+  }
+  for (size_t i = 1; i + 1 < hull.size(); i++) {
+    add_triangle(r_out, p_points[sorted[hull[0]].second],
+                 p_points[sorted[hull[i]].second],
+                 p_points[sorted[hull[i + 1]].second]);
+  }
+}
+
+// Incremental convex hull: each point outside the current hull replaces
+// the faces it sees with a fan to their horizon, O(n^2) overall
+void add_convex_hull(std::vector<Vector3> &r_out,
+                     const PackedVector3Array &p_points) {
+  int count = (int)p_points.size();
+  if (count < 3) {
+    return;
+  }
+  const Vector3 *pts = p_points.ptr();
+  float extent = 0.0f;
+  for (int axis = 0; axis < 3; axis++) {
+    float lo = pts[0][axis];
+    float hi = lo;
+    for (int i = 1; i < count; i++) {
+      lo = std::min(lo, pts[i][axis]);
+      hi = std::max(hi, pts[i][axis]);
+    }
+    extent = std::max(extent, hi - lo);
+  }
+  float eps = 1e-5f * std::max(extent, 1e-3f);
+
+  // Initial tetrahedron from extreme points
+  int i0 = 0, i1 = 0, i2 = -1, i3 = -1;
+  for (int i = 1; i < count; i++) {
+    if ((pts[i] - pts[i0]).length_squared() >
+        (pts[i1] - pts[i0]).length_squared()) {
+      i1 = i;
+    }
+  }
+  Vector3 axis = pts[i1] - pts[i0];
+  if (axis.length() <= eps) {
+    return;
+  }
+  float best = eps;
+  for (int i = 0; i < count; i++) {
+    float d = axis.cross(pts[i] - pts[i0]).length() / axis.length();
+    if (d > best) {
+      best = d;
+      i2 = i;
+    }
+  }
+  if (i2 < 0) {
+    return; // collinear
+  }
+  Vector3 plane_normal = axis.cross(pts[i2] - pts[i0]).normalized();
+  best = eps;
+  for (int i = 0; i < count; i++) {
+    float d = std::abs(plane_normal.dot(pts[i] - pts[i0]));
+    if (d > best) {
+      best = d;
+      i3 = i;
+    }
+  }
+  if (i3 < 0) {
+    add_planar_hull(r_out, pts, count, plane_normal);
+    return;
+  }
+
+  struct Face {
+    int v[3];
+    Vector3 normal; // unit, outward
+    float offset;
+  };
+  Vector3 inside = (pts[i0] + pts[i1] + pts[i2] + pts[i3]) * 0.25f;
+  auto make_face = [&](int p_a, int p_b, int p_c) {
+    Face face = {{p_a, p_b, p_c},
+                 (pts[p_b] - pts[p_a]).cross(pts[p_c] - pts[p_a]).normalized(),
+                 0.0f};
+    if (face.normal.dot(inside - pts[p_a]) > 0.0f) {
+      std::swap(face.v[1], face.v[2]);
+      face.normal = -face.normal;
+    }
+    face.offset = face.normal.dot(pts[p_a]);
+    return face;
+  };
+  std::vector<Face> faces = {make_face(i0, i1, i2), make_face(i0, i1, i3),
+                             make_face(i0, i2, i3), make_face(i1, i2, i3)};
+
+  std::vector<Face> kept;
+  std::vector<std::pair<int, int>> edges; // directed edges of seen faces
+  for (int p = 0; p < count; p++) {
+    if (p == i0 || p == i1 || p == i2 || p == i3) {
+      continue;
+    }
+    kept.clear();
+    edges.clear();
+    for (const Face &face : faces) {
+      if (face.normal.dot(pts[p]) - face.offset > eps) {
+        for (int e = 0; e < 3; e++) {
+          edges.push_back({face.v[e], face.v[(e + 1) % 3]});
+        }
+      } else {
+        kept.push_back(face);
+      }
+    }
+    if (edges.empty()) {
+      continue; // inside
+    }
+    // Horizon: seen edges whose reverse belongs to an unseen face. The
+    // new face keeps the edge's winding, so it faces outward too.
+    std::sort(edges.begin(), edges.end());
+    for (const std::pair<int, int> &edge : edges) {
+      if (!std::binary_search(edges.begin(), edges.end(),
+                              std::make_pair(edge.second, edge.first))) {
+        const Vector3 &a = pts[edge.first];
+        const Vector3 &b = pts[edge.second];
+        Vector3 normal = (b - a).cross(pts[p] - a).normalized();
+        kept.push_back(
+            {{edge.first, edge.second, p}, normal, normal.dot(a)});
+      }
+    }
+    faces.swap(kept);
+  }
+  for (const Face &face : faces) {
+    add_triangle(r_out, pts[face.v[0]], pts[face.v[1]], pts[face.v[2]]);
+  }
+}
+
+} // namespace
+
+void OceanObstacleRasterizer::_bind_methods() {
+  ClassDB::bind_method(D_METHOD("set_shape_obstacle", "p_id", "p_shape",
+                                "p_transform"),
+                       &OceanObstacleRasterizer::set_shape_obstacle);
+  ClassDB::bind_method(D_METHOD("set_mesh_obstacle", "p_id", "p_faces",
+                                "p_transform"),
+                       &OceanObstacleRasterizer::set_mesh_obstacle);
+  ClassDB::bind_method(D_METHOD("set_obstacle_transform", "p_id",
+                                "p_transform"),
+                       &OceanObstacleRasterizer::set_obstacle_transform);
+  ClassDB::bind_method(D_METHOD("remove_obstacle", "p_id"),
+                       &OceanObstacleRasterizer::remove_obstacle);
+  ClassDB::bind_method(D_METHOD("clear_obstacles"),
+                       &OceanObstacleRasterizer::clear_obstacles);
+  ClassDB::bind_method(D_METHOD("has_obstacle", "p_id"),
+                       &OceanObstacleRasterizer::has_obstacle);
+  ClassDB::bind_method(D_METHOD("get_obstacle_count"),
+                       &OceanObstacleRasterizer::get_obstacle_count);
+
+  ClassDB::bind_method(D_METHOD("bake", "p_full"),
+                       &OceanObstacleRasterizer::bake, DEFVAL(false));
+  ClassDB::bind_method(D_METHOD("get_obstacle_mask"),
+                       &OceanObstacleRasterizer::get_obstacle_mask);
+  ClassDB::bind_method(D_METHOD("get_depth_mask"),
+                       &OceanObstacleRasterizer::get_depth_mask);
+  ClassDB::bind_method(D_METHOD("apply_to_rgbaf", "p_data"),
+                       &OceanObstacleRasterizer::apply_to_rgbaf);
+
+  ClassDB::bind_method(D_METHOD("get_grid_res"),
+                       &OceanObstacleRasterizer::get_grid_res);
+  ClassDB::bind_method(D_METHOD("set_grid_res", "p_res"),
+                       &OceanObstacleRasterizer::set_grid_res);
+  ClassDB::add_property("OceanObstacleRasterizer",
+                        PropertyInfo(Variant::INT, "grid_res"), "set_grid_res",
+                        "get_grid_res");
+
+  ClassDB::bind_method(D_METHOD("get_sea_size"),
+                       &OceanObstacleRasterizer::get_sea_size);
+  ClassDB::bind_method(D_METHOD("set_sea_size", "p_size"),
+                       &OceanObstacleRasterizer::set_sea_size);
+  ClassDB::add_property("OceanObstacleRasterizer",
+                        PropertyInfo(Variant::VECTOR2, "sea_size"),
+                        "set_sea_size", "get_sea_size");
+
+  ClassDB::bind_method(D_METHOD("get_grid_transform"),
+                       &OceanObstacleRasterizer::get_grid_transform);
+  ClassDB::bind_method(D_METHOD("set_grid_transform", "p_transform"),
+                       &OceanObstacleRasterizer::set_grid_transform);
+  ClassDB::add_property("OceanObstacleRasterizer",
+                        PropertyInfo(Variant::TRANSFORM3D, "grid_transform"),
+                        "set_grid_transform", "get_grid_transform");
+
+  ClassDB::bind_method(D_METHOD("get_obstacle_height"),
+                       &OceanObstacleRasterizer::get_obstacle_height);
+  ClassDB::bind_method(D_METHOD("set_obstacle_height", "p_height"),
+                       &OceanObstacleRasterizer::set_obstacle_height);
+  ClassDB::add_property("OceanObstacleRasterizer",
+                        PropertyInfo(Variant::FLOAT, "obstacle_height"),
+                        "set_obstacle_height", "get_obstacle_height");
+
+  ClassDB::bind_method(D_METHOD("get_max_depth"),
+                       &OceanObstacleRasterizer::get_max_depth);
+  ClassDB::bind_method(D_METHOD("set_max_depth", "p_depth"),
+                       &OceanObstacleRasterizer::set_max_depth);
+  ClassDB::add_property("OceanObstacleRasterizer",
+                        PropertyInfo(Variant::FLOAT, "max_depth"),
+                        "set_max_depth", "get_max_depth");
+
+  ClassDB::bind_method(D_METHOD("get_use_threads"),
+                       &OceanObstacleRasterizer::get_use_threads);
+  ClassDB::bind_method(D_METHOD("set_use_threads", "p_enabled"),
+                       &OceanObstacleRasterizer::set_use_threads);
+  ClassDB::add_property("OceanObstacleRasterizer",
+                        PropertyInfo(Variant::BOOL, "use_threads"),
+                        "set_use_threads", "get_use_threads");
+}
+
+OceanObstacleRasterizer::OceanObstacleRasterizer() { _allocate(); }
+OceanObstacleRasterizer::~OceanObstacleRasterizer() {}
+
+void OceanObstacleRasterizer::_allocate() {
+  _tiles_x = (_grid_res + TILE_SIZE - 1) / TILE_SIZE;
+  _tile_dirty.assign(_tiles_x * _tiles_x, 1);
+  _top.assign(_grid_res * _grid_res, NO_SURFACE);
+}
+
+void OceanObstacleRasterizer::_invalidate() {
+  // Every tile is redone, and the old bins index the old tiles
+  _allocate();
+  for (Obstacle &obstacle : _obstacles) {
+    obstacle.bins.clear();
+    obstacle.stale = true;
+  }
+}
+
+int OceanObstacleRasterizer::_find_obstacle(int64_t p_id) const {
+  for (int i = 0; i < (int)_obstacles.size(); i++) {
+    if (_obstacles[i].id == p_id) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+void OceanObstacleRasterizer::_mark_bins_dirty(const Obstacle &p_obstacle) {
+  for (const std::pair<uint32_t, uint32_t> &bin : p_obstacle.bins) {
+    _tile_dirty[bin.first] = 1;
+  }
+}
+
+void OceanObstacleRasterizer::_prepare(Obstacle &r_obstacle) const {
+  int n = _grid_res;
+  Transform3D to_grid = _grid_transform.affine_inverse() * r_obstacle.transform;
+  float cells_x = n / std::max(_sea_size.x, 0.001f);
+  float cells_z = n / std::max(_sea_size.y, 0.001f);
+  int triangle_count = (int)r_obstacle.triangles.size() / 3;
+  r_obstacle.cells.resize(triangle_count * 9);
+  r_obstacle.bins.clear();
+
+  for (int t = 0; t < triangle_count; t++) {
+    float *v = r_obstacle.cells.data() + t * 9;
+    float min_x = std::numeric_limits<float>::max();
+    float max_x = -min_x;
+    float min_z = min_x;
+    float max_z = -min_x;
+    for (int i = 0; i < 3; i++) {
+      Vector3 p = to_grid.xform(r_obstacle.triangles[t * 3 + i]);
+      v[i * 3 + 0] = p.x * cells_x + n * 0.5f;
+      v[i * 3 + 1] = p.z * cells_z + n * 0.5f;
+      v[i * 3 + 2] = p.y;
+      min_x = std::min(min_x, v[i * 3 + 0]);
+      max_x = std::max(max_x, v[i * 3 + 0]);
+      min_z = std::min(min_z, v[i * 3 + 1]);
+      max_z = std::max(max_z, v[i * 3 + 1]);
+    }
+    // Cell samples sit on integer coordinates
+    int x0 = std::max((int)std::ceil(min_x), 0);
+    int x1 = std::min((int)std::floor(max_x), n - 1);
+    int z0 = std::max((int)std::ceil(min_z), 0);
+    int z1 = std::min((int)std::floor(max_z), n - 1);
+    if (x0 > x1 || z0 > z1) {
+      continue;
+    }
+    for (int tz = z0 / TILE_SIZE; tz <= z1 / TILE_SIZE; tz++) {
+      for (int tx = x0 / TILE_SIZE; tx <= x1 / TILE_SIZE; tx++) {
+        r_obstacle.bins.push_back(
+            std::make_pair((uint32_t)(tz * _tiles_x + tx), (uint32_t)t));
+      }
+    }
+  }
+  std::sort(r_obstacle.bins.begin(), r_obstacle.bins.end());
+}
+
+void OceanObstacleRasterizer::_bake_tile(uint32_t p_index) {
+  uint32_t tile = _dirty_tiles[p_index];
+  int n = _grid_res;
+  int x_begin = (int)(tile % _tiles_x) * TILE_SIZE;
+  int z_begin = (int)(tile / _tiles_x) * TILE_SIZE;
+  int x_end = std::min(x_begin + TILE_SIZE, n) - 1;
+  int z_end = std::min(z_begin + TILE_SIZE, n) - 1;
+  for (int z = z_begin; z <= z_end; z++) {
+    std::fill(_top.begin() + z * n + x_begin, _top.begin() + z * n + x_end + 1,
+              NO_SURFACE);
+  }
+
+  const std::pair<uint32_t, uint32_t> first(tile, 0);
+  for (const Obstacle &obstacle : _obstacles) {
+    auto it =
+        std::lower_bound(obstacle.bins.begin(), obstacle.bins.end(), first);
+    for (; it != obstacle.bins.end() && it->first == tile; ++it) {
+      const float *v = obstacle.cells.data() + it->second * 9;
+      float ax = v[0], az = v[1], ay = v[2];
+      float bx = v[3], bz = v[4], by = v[5];
+      float cx = v[6], cz = v[7], cy = v[8];
+      float area = (bx - ax) * (cz - az) - (bz - az) * (cx - ax);
+      // Walls seen edge on have no top to hit
+      if (std::fabs(area) < 1e-8f) {
+        continue;
+      }
+      float inv_area = 1.0f / area;
+      float eps = -1e-5f;
+      int x0 = std::max((int)std::ceil(std::min({ax, bx, cx})), x_begin);
+      int x1 = std::min((int)std::floor(std::max({ax, bx, cx})), x_end);
+      int z0 = std::max((int)std::ceil(std::min({az, bz, cz})), z_begin);
+      int z1 = std::min((int)std::floor(std::max({az, bz, cz})), z_end);
+      for (int z = z0; z <= z1; z++) {
+        float *top = _top.data() + z * n;
+        for (int x = x0; x <= x1; x++) {
+          // Barycentric weights, positive inside either winding
+          float wa = ((bx - x) * (cz - z) - (bz - z) * (cx - x)) * inv_area;
+          float wb = ((cx - x) * (az - z) - (cz - z) * (ax - x)) * inv_area;
+          float wc = 1.0f - wa - wb;
+          if (wa < eps || wb < eps || wc < eps) {
+            continue;
+          }
+          top[x] = std::max(top[x], wa * ay + wb * by + wc * cy);
+        }
+      }
+    }
+  }
+}
+
+void OceanObstacleRasterizer::_set_obstacle(int64_t p_id,
+                                            std::vector<Vector3> &&p_triangles,
+                                            const Transform3D &p_transform) {
+  int index = _find_obstacle(p_id);
+  if (index < 0) {
+    index = (int)_obstacles.size();
+    _obstacles.push_back(Obstacle());
+    _obstacles[index].id = p_id;
+  }
+  Obstacle &obstacle = _obstacles[index];
+  obstacle.triangles = std::move(p_triangles);
+  obstacle.transform = p_transform;
+  obstacle.stale = true;
+}
+
+void OceanObstacleRasterizer::set_shape_obstacle(
+    int64_t p_id, const Ref<Shape3D> &p_shape,
+    const Transform3D &p_transform) {
+  ERR_FAIL_COND_MSG(p_shape.is_null(), "Obstacle shape is null.");
+  std::vector<Vector3> triangles;
+
+  if (BoxShape3D *box = Object::cast_to<BoxShape3D>(p_shape.ptr())) {
+    add_box(triangles, box->get_size());
+  } else if (SphereShape3D *sphere =
+                 Object::cast_to<SphereShape3D>(p_shape.ptr())) {
+    std::vector<Vector2> profile;
+    float radius = sphere->get_radius();
+    add_hemisphere_profile(profile, radius, 0.0f, 1.0f);
+    std::vector<Vector2> bottom;
+    add_hemisphere_profile(bottom, radius, 0.0f, -1.0f);
+    profile.insert(profile.end(), bottom.rbegin() + 1, bottom.rend());
+    add_revolved(triangles, profile);
+  } else if (CapsuleShape3D *capsule =
+                 Object::cast_to<CapsuleShape3D>(p_shape.ptr())) {
+    // height is the total height, caps included
+    float radius = capsule->get_radius();
+    float half = std::max(capsule->get_height() * 0.5f - radius, 0.0f);
+    std::vector<Vector2> profile;
+    add_hemisphere_profile(profile, radius, half, 1.0f);
+    std::vector<Vector2> bottom;
+    add_hemisphere_profile(bottom, radius, -half, -1.0f);
+    profile.insert(profile.end(), bottom.rbegin(), bottom.rend());
+    add_revolved(triangles, profile);
+  } else if (CylinderShape3D *cylinder =
+                 Object::cast_to<CylinderShape3D>(p_shape.ptr())) {
+    float radius = cylinder->get_radius();
+    float half = cylinder->get_height() * 0.5f;
+    add_revolved(triangles, {Vector2(0.0f, half), Vector2(radius, half),
+                             Vector2(radius, -half), Vector2(0.0f, -half)});
+  } else if (ConcavePolygonShape3D *concave =
+                 Object::cast_to<ConcavePolygonShape3D>(p_shape.ptr())) {
+    PackedVector3Array faces = concave->get_faces();
+    triangles.assign(faces.ptr(), faces.ptr() + faces.size() / 3 * 3);
+  } else if (ConvexPolygonShape3D *convex =
+                 Object::cast_to<ConvexPolygonShape3D>(p_shape.ptr())) {
+    add_convex_hull(triangles, convex->get_points());
+  } else if (HeightMapShape3D *height_map =
+                 Object::cast_to<HeightMapShape3D>(p_shape.ptr())) {
+    // Unit spaced samples, centred on the shape origin
+    int width = height_map->get_map_width();
+    int depth = height_map->get_map_depth();
+    PackedFloat32Array data = height_map->get_map_data();
+    ERR_FAIL_COND_MSG((int)data.size() < width * depth,
+                      "Height map data is smaller than its size.");
+    const float *h = data.ptr();
+    float ox = (width - 1) * 0.5f;
+    float oz = (depth - 1) * 0.5f;
+    for (int z = 0; z + 1 < depth; z++) {
+      for (int x = 0; x + 1 < width; x++) {
+        float h00 = h[z * width + x];
+        float h10 = h[z * width + x + 1];
+        float h01 = h[(z + 1) * width + x];
+        float h11 = h[(z + 1) * width + x + 1];
+        // Holes are non finite
+        if (!std::isfinite(h00 + h10 + h01 + h11)) {
+          continue;
+        }
+        Vector3 p00(x - ox, h00, z - oz);
+        Vector3 p10(x + 1 - ox, h10, z - oz);
+        Vector3 p01(x - ox, h01, z + 1 - oz);
+        Vector3 p11(x + 1 - ox, h11, z + 1 - oz);
+        add_triangle(triangles, p00, p10, p11);
+        add_triangle(triangles, p00, p11, p01);
+      }
+    }
+  } else {
+    ERR_FAIL_MSG("Obstacle shape type is not supported.");
+  }
+  _set_obstacle(p_id, std::move(triangles), p_transform);
+}
+
+void OceanObstacleRasterizer::set_mesh_obstacle(
+    int64_t p_id, const PackedVector3Array &p_faces,
+    const Transform3D &p_transform) {
+  ERR_FAIL_COND_MSG(p_faces.size() % 3 != 0,
+                    "Mesh faces must hold 3 vertices per triangle.");
+  std::vector<Vector3> triangles(p_faces.ptr(), p_faces.ptr() + p_faces.size());
+  _set_obstacle(p_id, std::move(triangles), p_transform);
+}
+
+void OceanObstacleRasterizer::set_obstacle_transform(
+    int64_t p_id, const Transform3D &p_transform) {
+  int index = _find_obstacle(p_id);
+  ERR_FAIL_COND_MSG(index < 0, "Unknown obstacle id.");
+  _obstacles[index].transform = p_transform;
+  _obstacles[index].stale = true;
+}
+
+void OceanObstacleRasterizer::remove_obstacle(int64_t p_id) {
+  int index = _find_obstacle(p_id);
+  if (index < 0) {
+    return;
+  }
+  _mark_bins_dirty(_obstacles[index]);
+  _obstacles.erase(_obstacles.begin() + index);
+}
+
+void OceanObstacleRasterizer::clear_obstacles() {
+  for (const Obstacle &obstacle : _obstacles) {
+    _mark_bins_dirty(obstacle);
+  }
+  _obstacles.clear();
+}
+
+bool OceanObstacleRasterizer::has_obstacle(int64_t p_id) const {
+  return _find_obstacle(p_id) >= 0;
+}
+
+int OceanObstacleRasterizer::get_obstacle_count() const {
+  return (int)_obstacles.size();
+}
+
+int OceanObstacleRasterizer::bake(bool p_full) {
+  if (p_full) {
+    std::fill(_tile_dirty.begin(), _tile_dirty.end(), 1);
+  }
+  // Both the old and the new footprint of a moved obstacle are redone
+  for (Obstacle &obstacle : _obstacles) {
+    if (!obstacle.stale) {
+      continue;
+    }
+    _mark_bins_dirty(obstacle);
+    _prepare(obstacle);
+    _mark_bins_dirty(obstacle);
+    obstacle.stale = false;
+  }
+
+  _dirty_tiles.clear();
+  for (uint32_t tile = 0; tile < _tile_dirty.size(); tile++) {
+    if (_tile_dirty[tile]) {
+      _dirty_tiles.push_back(tile);
+      _tile_dirty[tile] = 0;
+    }
+  }
+  int count = (int)_dirty_tiles.size();
+  if (_use_threads && count > 1) {
+    WorkerThreadPool *pool = WorkerThreadPool::get_singleton();
+    int64_t task = pool->add_group_task(
+        callable_mp(this, &OceanObstacleRasterizer::_bake_tile), count, -1,
+        true, "OceanObstacleRasterizer bake");
+    pool->wait_for_group_task_completion(task);
+  } else {
+    for (int i = 0; i < count; i++) {
+      _bake_tile(i);
+    }
+  }
+  return count;
+}
+
+PackedByteArray OceanObstacleRasterizer::get_obstacle_mask() const {
+  PackedByteArray result;
+  result.resize(_top.size());
+  uint8_t *out = result.ptrw();
+  for (int i = 0; i < (int)_top.size(); i++) {
+    out[i] = _top[i] > _obstacle_height ? 255 : 0;
+  }
+  return result;
+}
+
+PackedFloat32Array OceanObstacleRasterizer::get_depth_mask() const {
+  PackedFloat32Array result;
+  result.resize(_top.size());
+  float *out = result.ptrw();
+  for (int i = 0; i < (int)_top.size(); i++) {
+    out[i] = std::min(std::max(-_top[i], 0.0f), _max_depth);
+  }
+  return result;
+}
+
+PackedByteArray
+OceanObstacleRasterizer::apply_to_rgbaf(const PackedByteArray &p_data) const {
+  ERR_FAIL_COND_V_MSG(p_data.size() != (int64_t)(_top.size() * 4 * sizeof(float)),
+                      p_data,
+                      "Data must hold grid_res * grid_res RGBA float texels.");
+  PackedByteArray result = p_data;
+  float *texels = (float *)result.ptrw();
+  for (int i = 0; i < (int)_top.size(); i++) {
+    texels[i * 4 + 3] = _top[i] > _obstacle_height ? 1.0f : 0.0f;
+  }
+  return result;
+}
+
+void OceanObstacleRasterizer::set_grid_res(int p_res) {
+  ERR_FAIL_COND_MSG(p_res < 8, "grid_res must be at least 8.");
+  if (p_res == _grid_res) {
+    return;
+  }
+  _grid_res = p_res;
+  _invalidate();
+}
+int OceanObstacleRasterizer::get_grid_res() const { return _grid_res; }
+
+void OceanObstacleRasterizer::set_sea_size(const Vector2 &p_size) {
+  _sea_size = p_size;
+  _invalidate();
+}
+Vector2 OceanObstacleRasterizer::get_sea_size() const { return _sea_size; }
+
+void OceanObstacleRasterizer::set_grid_transform(
+    const Transform3D &p_transform) {
+  _grid_transform = p_transform;
+  _invalidate();
+}
+Transform3D OceanObstacleRasterizer::get_grid_transform() const {
+  return _grid_transform;
+}
+
+void OceanObstacleRasterizer::set_obstacle_height(float p_height) {
+  _obstacle_height = p_height;
+}
+float OceanObstacleRasterizer::get_obstacle_height() const {
+  return _obstacle_height;
+}
+
+void OceanObstacleRasterizer::set_max_depth(float p_depth) {
+  _max_depth = p_depth;
+}
+float OceanObstacleRasterizer::get_max_depth() const { return _max_depth; }
+
+void OceanObstacleRasterizer::set_use_threads(bool p_enabled) {
+  _use_threads = p_enabled;
+}
+bool OceanObstacleRasterizer::get_use_threads() const { return _use_threads; }
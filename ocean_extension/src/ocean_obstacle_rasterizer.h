@@ -0,0 +1,119 @@
+#ifndef OCEAN_OBSTACLE_RASTERIZER_H
+#define OCEAN_OBSTACLE_RASTERIZER_H
+
+#include <godot_cpp/classes/ref_counted.hpp>
+#include <godot_cpp/classes/shape3d.hpp>
+#include <godot_cpp/core/class_db.hpp>
+#include <godot_cpp/variant/packed_byte_array.hpp>
+#include <godot_cpp/variant/packed_float32_array.hpp>
+#include <godot_cpp/variant/packed_vector3_array.hpp>
+#include <godot_cpp/variant/transform3d.hpp>
+#include <godot_cpp/variant/vector2.hpp>
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace godot {
+
+// Bakes the obstacle and depth masks of the shallow-water grid from
+// collision shapes and mesh triangles, replacing the per-cell raycasts of
+// WaterManager._bake_obstacles_async. Each cell sample at
+// ((x / grid_res - 0.5) * sea_size) in grid_transform space takes the
+// highest surface above it, as a ray cast down from above would.
+//
+// The grid is baked in 16 x 16 cell tiles on the WorkerThreadPool.
+// Triangles are binned to tiles when an obstacle is added or moves, and
+// bake() only redoes the tiles its old and new footprints touch.
+class OceanObstacleRasterizer : public RefCounted {
+  GDCLASS(OceanObstacleRasterizer, RefCounted)
+
+private:
+  struct Obstacle {
+    int64_t id = 0;
+    std::vector<Vector3> triangles; // obstacle space, 3 per triangle
+    Transform3D transform;
+    bool stale = true; // grid data must be rebuilt by the next bake
+    // Per triangle: x, z in cells and y in grid space, per vertex
+    std::vector<float> cells;
+    // (tile, triangle), sorted by tile
+    std::vector<std::pair<uint32_t, uint32_t>> bins;
+  };
+
+  int _grid_res = 128;
+  Vector2 _sea_size = Vector2(80.0f, 80.0f);
+  Transform3D _grid_transform;
+  float _obstacle_height = 0.1f; // a surface above this is solid
+  float _max_depth = 100.0f;     // depth where no surface is found
+  bool _use_threads = true;
+
+  std::vector<Obstacle> _obstacles;
+  int _tiles_x = 0;
+  std::vector<uint8_t> _tile_dirty;
+  std::vector<uint32_t> _dirty_tiles; // tiles of the running bake
+  // Highest surface per cell, grid space; -inf where none
+  std::vector<float> _top;
+
+  void _allocate();
+  int _find_obstacle(int64_t p_id) const;
+  void _mark_bins_dirty(const Obstacle &p_obstacle);
+  void _prepare(Obstacle &r_obstacle) const;
+  void _bake_tile(uint32_t p_index);
+  void _set_obstacle(int64_t p_id, std::vector<Vector3> &&p_triangles,
+                     const Transform3D &p_transform);
+  void _invalidate();
+
+protected:
+  static void _bind_methods();
+
+public:
+  OceanObstacleRasterizer();
+  ~OceanObstacleRasterizer();
+
+  // Box, sphere, capsule, cylinder, concave, convex and height map
+  // shapes; curved ones are tessellated
+  void set_shape_obstacle(int64_t p_id, const Ref<Shape3D> &p_shape,
+                          const Transform3D &p_transform);
+  // Triangle list, 3 vertices per triangle, e.g. Mesh.get_faces()
+  void set_mesh_obstacle(int64_t p_id, const PackedVector3Array &p_faces,
+                         const Transform3D &p_transform);
+  void set_obstacle_transform(int64_t p_id, const Transform3D &p_transform);
+  void remove_obstacle(int64_t p_id);
+  void clear_obstacles();
+  bool has_obstacle(int64_t p_id) const;
+  int get_obstacle_count() const;
+
+  // Rebakes the tiles touched since the last bake, or every tile;
+  // returns the number of tiles baked
+  int bake(bool p_full);
+
+  // grid_res^2 bytes, 255 solid
+  PackedByteArray get_obstacle_mask() const;
+  // grid_res^2 water depths (m) above the highest surface, 0 on land
+  PackedFloat32Array get_depth_mask() const;
+  // Writes the obstacle mask into the alpha channel of grid_res^2 RGBA
+  // float texels, the layout of WaterManager's sim_image
+  PackedByteArray apply_to_rgbaf(const PackedByteArray &p_data) const;
+
+  void set_grid_res(int p_res);
+  int get_grid_res() const;
+
+  void set_sea_size(const Vector2 &p_size);
+  Vector2 get_sea_size() const;
+
+  void set_grid_transform(const Transform3D &p_transform);
+  Transform3D get_grid_transform() const;
+
+  void set_obstacle_height(float p_height);
+  float get_obstacle_height() const;
+
+  void set_max_depth(float p_depth);
+  float get_max_depth() const;
+
+  void set_use_threads(bool p_enabled);
+  bool get_use_threads() const;
+};
+
+} // namespace godot
+
+#endif
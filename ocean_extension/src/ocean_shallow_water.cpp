@@ -0,0 +1,731 @@
+#include "ocean_shallow_water.h"
+#include <algorithm>
+#include <cmath>
+#include <godot_cpp/classes/worker_thread_pool.hpp>
+#include <godot_cpp/core/class_db.hpp>
+#include <godot_cpp/variant/callable_method_pointer.hpp>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define OCEAN_SWE_SSE 1
+#include <immintrin.h>
+#endif
+
+using namespace godot;
+
+namespace {
+
+// Rows per worker task
+const int ROWS_PER_BAND = 8;
+// Constants of water_interaction.glsl
+const float H_EPS = 1e-4f;
+const float VELOCITY_MIN_DEPTH = 0.1f;
+const float MAX_HEIGHT = 10.0f;
+const float CFL_ALPHA = 0.5f;
+const float MAX_DT = 0.02f;
+
+// The cell updates below are written once for one float and, with SSE,
+// for four neighbouring cells; these overloads are all they use
+inline float lane_load(const float *p, float) { return *p; }
+inline void lane_store(float *p, float v) { *p = v; }
+inline float lane_max(float a, float b) { return std::max(a, b); }
+inline float lane_min(float a, float b) { return std::min(a, b); }
+inline float lane_abs(float a) { return std::fabs(a); }
+inline float lane_sqrt(float a) { return std::sqrt(a); }
+inline bool lane_less(float a, float b) { return a < b; }
+inline bool lane_less_equal(float a, float b) { return a <= b; }
+inline float lane_select(bool m, float a, float b) { return m ? a : b; }
+
+#ifdef OCEAN_SWE_SSE
+struct Lanes4 {
+  __m128 v;
+  Lanes4() : v(_mm_setzero_ps()) {}
+  Lanes4(__m128 p_v) : v(p_v) {}
+  Lanes4(float p_f) : v(_mm_set1_ps(p_f)) {}
+};
+inline Lanes4 operator+(Lanes4 a, Lanes4 b) { return _mm_add_ps(a.v, b.v); }
+inline Lanes4 operator-(Lanes4 a, Lanes4 b) { return _mm_sub_ps(a.v, b.v); }
+inline Lanes4 operator*(Lanes4 a, Lanes4 b) { return _mm_mul_ps(a.v, b.v); }
+inline Lanes4 operator/(Lanes4 a, Lanes4 b) { return _mm_div_ps(a.v, b.v); }
+inline Lanes4 lane_load(const float *p, Lanes4) { return _mm_loadu_ps(p); }
+inline void lane_store(float *p, Lanes4 v) { _mm_storeu_ps(p, v.v); }
+inline Lanes4 lane_max(Lanes4 a, Lanes4 b) { return _mm_max_ps(a.v, b.v); }
+inline Lanes4 lane_min(Lanes4 a, Lanes4 b) { return _mm_min_ps(a.v, b.v); }
+inline Lanes4 lane_abs(Lanes4 a) {
+  return _mm_andnot_ps(_mm_set1_ps(-0.0f), a.v);
+}
+inline Lanes4 lane_sqrt(Lanes4 a) { return _mm_sqrt_ps(a.v); }
+inline Lanes4 lane_less(Lanes4 a, Lanes4 b) { return _mm_cmplt_ps(a.v, b.v); }
+inline Lanes4 lane_less_equal(Lanes4 a, Lanes4 b) {
+  return _mm_cmple_ps(a.v, b.v);
+}
+inline Lanes4 lane_select(Lanes4 m, Lanes4 a, Lanes4 b) {
+  return _mm_or_ps(_mm_and_ps(m.v, a.v), _mm_andnot_ps(m.v, b.v));
+}
+#endif
+
+// One row of one field and its neighbours above and below, clamped
+struct Rows {
+  const float *c;
+  const float *u;
+  const float *d;
+};
+
+// Lax-Friedrichs update of the cells at x (one or four), x_left and
+// x_right being the clamped neighbours, then damping and the obstacle
+// mask: steps 2 to 7 of water_interaction.glsl
+template <class V>
+inline void update_cells(const OceanShallowWater::StepConstants &k,
+                         const Rows &h, const Rows &hu, const Rows &hv,
+                         const float *obstacle, int x, int x_left,
+                         int x_right, float *r_h, float *r_hu, float *r_hv) {
+  const V tag = V();
+  V hC = lane_load(h.c + x, tag);
+  V huC = lane_load(hu.c + x, tag);
+  V hvC = lane_load(hv.c + x, tag);
+  V hL = lane_load(h.c + x_left, tag);
+  V huL = lane_load(hu.c + x_left, tag);
+  V hvL = lane_load(hv.c + x_left, tag);
+  V hR = lane_load(h.c + x_right, tag);
+  V huR = lane_load(hu.c + x_right, tag);
+  V hvR = lane_load(hv.c + x_right, tag);
+  V hU = lane_load(h.u + x, tag);
+  V huU = lane_load(hu.u + x, tag);
+  V hvU = lane_load(hv.u + x, tag);
+  V hD = lane_load(h.d + x, tag);
+  V huD = lane_load(hu.d + x, tag);
+  V hvD = lane_load(hv.d + x, tag);
+
+  V g = k.gravity;
+  V depth = k.depth;
+  V HC = lane_max(depth + hC, V(H_EPS));
+  V HL = lane_max(depth + hL, V(H_EPS));
+  V HR = lane_max(depth + hR, V(H_EPS));
+  V HU = lane_max(depth + hU, V(H_EPS));
+  V HD = lane_max(depth + hD, V(H_EPS));
+
+  // Velocities with the depth floored, so nearly dry cells do not blow up
+  V one = 1.0f;
+  V min_depth = VELOCITY_MIN_DEPTH;
+  V invC = one / lane_max(HC, min_depth);
+  V invL = one / lane_max(HL, min_depth);
+  V invR = one / lane_max(HR, min_depth);
+  V invU = one / lane_max(HU, min_depth);
+  V invD = one / lane_max(HD, min_depth);
+  V uC = huC * invC;
+  V vC = hvC * invC;
+  V uL = huL * invL;
+  V vL = hvL * invL;
+  V uR = huR * invR;
+  V vR = hvR * invR;
+  V vU = hvU * invU;
+  V vD = hvD * invD;
+
+  // Fastest wave per axis, c = sqrt(gH)
+  V cC = lane_sqrt(g * HC);
+  V alpha_x = lane_max(lane_abs(uC) + cC,
+                       lane_max(lane_abs(uL) + lane_sqrt(g * HL),
+                                lane_abs(uR) + lane_sqrt(g * HR)));
+  V alpha_y = lane_max(lane_abs(vC) + cC,
+                       lane_max(lane_abs(vU) + lane_sqrt(g * HU),
+                                lane_abs(vD) + lane_sqrt(g * HD)));
+
+  // F = [hu, hu^2/H + gH^2/2, huv/H], G = [hv, huv/H, hv^2/H + gH^2/2]
+  V half = 0.5f;
+  V two = 2.0f;
+  V half_g = 0.5f * k.gravity;
+  V ax = half * alpha_x;
+  V ay = half * alpha_y;
+  V dF0 = (huR - huL) * half - ax * (hR - two * hC + hL);
+  V dF1 = ((huR * uR + half_g * HR * HR) - (huL * uL + half_g * HL * HL)) *
+              half -
+          ax * (huR - two * huC + huL);
+  V dF2 = (huR * vR - huL * vL) * half - ax * (hvR - two * hvC + hvL);
+  V dG0 = (hvD - hvU) * half - ay * (hD - two * hC + hU);
+  V dG1 = (huD * vD - huU * vU) * half - ay * (huD - two * huC + huU);
+  V dG2 = ((hvD * vD + half_g * HD * HD) - (hvU * vU + half_g * HU * HU)) *
+              half -
+          ay * (hvD - two * hvC + hvU);
+
+  V dt = k.dt;
+  V damping = k.damping;
+  V next_h = hC - dt * (dF0 + dG0);
+  V next_hu = (huC - dt * (dF1 + dG1)) * damping;
+  V next_hv = (hvC - dt * (dF2 + dG2)) * damping;
+
+  V solid = lane_less(V(0.5f), lane_load(obstacle + x, tag));
+  V zero = 0.0f;
+  lane_store(r_h + x, lane_select(solid, zero, next_h));
+  lane_store(r_hu + x, lane_select(solid, zero, next_hu));
+  lane_store(r_hv + x, lane_select(solid, zero, next_hv));
+}
+
+// Absorbing border, height clamp, dry damping and the CFL speed limit:
+// step 10 onwards of water_interaction.glsl
+template <class V>
+inline void finish_cells(const OceanShallowWater::StepConstants &k,
+                         const float *edge_distance, float row_distance, int x,
+                         float *r_h, float *r_hu, float *r_hv) {
+  const V tag = V();
+  V h = lane_load(r_h + x, tag);
+  V hu = lane_load(r_hu + x, tag);
+  V hv = lane_load(r_hv + x, tag);
+  V one = 1.0f;
+  V zero = 0.0f;
+
+  if (k.margin > 0) {
+    V edge = lane_min(lane_load(edge_distance + x, tag), V(row_distance));
+    V in_margin = lane_less(edge, V((float)k.margin));
+    V factor = edge * V(1.0f / k.margin);
+    V absorb = one / (one + (one - factor) * V(10.0f));
+    V still = lane_less(factor, V(0.2f));
+    h = lane_select(in_margin, h * (V(0.5f) + V(0.5f) * factor), h);
+    hu = lane_select(in_margin, lane_select(still, zero, hu * absorb), hu);
+    hv = lane_select(in_margin, lane_select(still, zero, hv * absorb), hv);
+  }
+
+  V min_h = 0.05f - k.depth;
+  h = lane_min(lane_max(h, min_h), V(MAX_HEIGHT));
+  V dry = lane_less_equal(h, min_h + V(0.05f));
+  hu = lane_select(dry, hu * V(0.5f), hu);
+  hv = lane_select(dry, hv * V(0.5f), hv);
+
+  V max_speed = CFL_ALPHA / std::max(k.dt, 1e-6f);
+  V inv_depth = one / lane_max(V(k.depth) + h, V(VELOCITY_MIN_DEPTH));
+  V speed = lane_sqrt(hu * hu + hv * hv) * inv_depth;
+  V too_fast = lane_less(max_speed, speed);
+  // speed is above max_speed > 0 wherever the scale is used
+  V scale = max_speed / lane_max(speed, V(1e-20f));
+  hu = lane_select(too_fast, hu * scale, hu);
+  hv = lane_select(too_fast, hv * scale, hv);
+
+  lane_store(r_h + x, h);
+  lane_store(r_hu + x, hu);
+  lane_store(r_hv + x, hv);
+}
+
+inline float fract(float p_value) { return p_value - std::floor(p_value); }
+
+// hash() of water_interaction.glsl
+float rain_hash(float x, float y) {
+  x = fract(x * 123.34f);
+  y = fract(y * 456.21f);
+  float d = x * (x + 45.32f) + y * (y + 45.32f);
+  return fract((x + d) * (y + d));
+}
+
+float smoothstep(float p_from, float p_to, float p_value) {
+  float t = std::min(std::max((p_value - p_from) / (p_to - p_from), 0.0f), 1.0f);
+  return t * t * (3.0f - 2.0f * t);
+}
+
+} // namespace
+
+void OceanShallowWater::_bind_methods() {
+  ClassDB::bind_method(D_METHOD("step", "p_delta"), &OceanShallowWater::step);
+  ClassDB::bind_method(D_METHOD("reset"), &OceanShallowWater::reset);
+
+  ClassDB::bind_method(D_METHOD("trigger_ripple", "p_world_pos", "p_strength",
+                                "p_radius"),
+                       &OceanShallowWater::trigger_ripple, DEFVAL(1.0f),
+                       DEFVAL(0.05f));
+  ClassDB::bind_method(D_METHOD("trigger_water_injection", "p_world_pos",
+                                "p_added_height", "p_radius"),
+                       &OceanShallowWater::trigger_water_injection,
+                       DEFVAL(2.0f));
+  ClassDB::bind_method(D_METHOD("trigger_vortex", "p_local_pos", "p_radius",
+                                "p_intensity", "p_speed", "p_depth"),
+                       &OceanShallowWater::trigger_vortex, DEFVAL(10.0f),
+                       DEFVAL(1.0f), DEFVAL(2.0f), DEFVAL(5.0f));
+  ClassDB::bind_method(D_METHOD("clear_vortex"),
+                       &OceanShallowWater::clear_vortex);
+
+  ClassDB::bind_method(D_METHOD("update_scroll", "p_center"),
+                       &OceanShallowWater::update_scroll);
+  ClassDB::bind_method(D_METHOD("get_scroll_origin"),
+                       &OceanShallowWater::get_scroll_origin);
+  ClassDB::bind_method(D_METHOD("set_scroll_origin", "p_origin"),
+                       &OceanShallowWater::set_scroll_origin);
+  ClassDB::add_property("OceanShallowWater",
+                        PropertyInfo(Variant::VECTOR2, "scroll_origin"),
+                        "set_scroll_origin", "get_scroll_origin");
+
+  ClassDB::bind_method(D_METHOD("get_height_at", "p_world_pos"),
+                       &OceanShallowWater::get_height_at);
+  ClassDB::bind_method(D_METHOD("get_height_buffer"),
+                       &OceanShallowWater::get_height_buffer);
+  ClassDB::bind_method(D_METHOD("get_state_buffer"),
+                       &OceanShallowWater::get_state_buffer);
+  ClassDB::bind_method(D_METHOD("get_obstacle_mask"),
+                       &OceanShallowWater::get_obstacle_mask);
+  ClassDB::bind_method(D_METHOD("set_obstacle_mask", "p_mask"),
+                       &OceanShallowWater::set_obstacle_mask);
+
+  ClassDB::bind_method(D_METHOD("get_grid_res"),
+                       &OceanShallowWater::get_grid_res);
+  ClassDB::bind_method(D_METHOD("set_grid_res", "p_res"),
+                       &OceanShallowWater::set_grid_res);
+  ClassDB::add_property("OceanShallowWater",
+                        PropertyInfo(Variant::INT, "grid_res"), "set_grid_res",
+                        "get_grid_res");
+
+  ClassDB::bind_method(D_METHOD("get_sea_size"),
+                       &OceanShallowWater::get_sea_size);
+  ClassDB::bind_method(D_METHOD("set_sea_size", "p_size"),
+                       &OceanShallowWater::set_sea_size);
+  ClassDB::add_property("OceanShallowWater",
+                        PropertyInfo(Variant::VECTOR2, "sea_size"),
+                        "set_sea_size", "get_sea_size");
+
+  ClassDB::bind_method(D_METHOD("get_damping"),
+                       &OceanShallowWater::get_damping);
+  ClassDB::bind_method(D_METHOD("set_damping", "p_damping"),
+                       &OceanShallowWater::set_damping);
+  ClassDB::add_property("OceanShallowWater",
+                        PropertyInfo(Variant::FLOAT, "damping"), "set_damping",
+                        "get_damping");
+
+  ClassDB::bind_method(D_METHOD("get_gravity"),
+                       &OceanShallowWater::get_gravity);
+  ClassDB::bind_method(D_METHOD("set_gravity", "p_gravity"),
+                       &OceanShallowWater::set_gravity);
+  ClassDB::add_property("OceanShallowWater",
+                        PropertyInfo(Variant::FLOAT, "gravity"), "set_gravity",
+                        "get_gravity");
+
+  ClassDB::bind_method(D_METHOD("get_base_depth"),
+                       &OceanShallowWater::get_base_depth);
+  ClassDB::bind_method(D_METHOD("set_base_depth", "p_depth"),
+                       &OceanShallowWater::set_base_depth);
+  ClassDB::add_property("OceanShallowWater",
+                        PropertyInfo(Variant::FLOAT, "base_depth"),
+                        "set_base_depth", "get_base_depth");
+
+  ClassDB::bind_method(D_METHOD("get_rain_intensity"),
+                       &OceanShallowWater::get_rain_intensity);
+  ClassDB::bind_method(D_METHOD("set_rain_intensity", "p_intensity"),
+                       &OceanShallowWater::set_rain_intensity);
+  ClassDB::add_property("OceanShallowWater",
+                        PropertyInfo(Variant::FLOAT, "rain_intensity"),
+                        "set_rain_intensity", "get_rain_intensity");
+
+  ClassDB::bind_method(D_METHOD("get_use_threads"),
+                       &OceanShallowWater::get_use_threads);
+  ClassDB::bind_method(D_METHOD("set_use_threads", "p_enabled"),
+                       &OceanShallowWater::set_use_threads);
+  ClassDB::add_property("OceanShallowWater",
+                        PropertyInfo(Variant::BOOL, "use_threads"),
+                        "set_use_threads", "get_use_threads");
+}
+
+OceanShallowWater::OceanShallowWater() { _allocate(); }
+OceanShallowWater::~OceanShallowWater() {}
+
+void OceanShallowWater::_allocate() {
+  int cells = _grid_res * _grid_res;
+  for (int i = 0; i < 2; i++) {
+    _h[i].assign(cells, 0.0f);
+    _hu[i].assign(cells, 0.0f);
+    _hv[i].assign(cells, 0.0f);
+  }
+  _obstacle.assign(cells, 0.0f);
+  _edge_distance.resize(_grid_res);
+  for (int x = 0; x < _grid_res; x++) {
+    _edge_distance[x] = (float)std::min(x, _grid_res - 1 - x);
+  }
+  _current = 0;
+}
+
+void OceanShallowWater::step(float p_delta) {
+  _time += p_delta;
+  _constants.dt = std::min(p_delta, MAX_DT);
+  _constants.damping = _damping;
+  _constants.gravity = _gravity > 0.1f ? _gravity : 9.81f;
+  _constants.depth = _base_depth > 0.01f ? _base_depth : 1.0f;
+  _constants.rain = _rain_intensity;
+  _constants.time = _time;
+  _constants.margin = (int)(_grid_res * 0.10f);
+
+  int bands = (_grid_res + ROWS_PER_BAND - 1) / ROWS_PER_BAND;
+  if (_use_threads && bands > 1) {
+    WorkerThreadPool *pool = WorkerThreadPool::get_singleton();
+    int64_t task = pool->add_group_task(
+        callable_mp(this, &OceanShallowWater::_step_rows), bands, -1, true,
+        "OceanShallowWater step");
+    pool->wait_for_group_task_completion(task);
+  } else {
+    for (int band = 0; band < bands; band++) {
+      _step_rows(band);
+    }
+  }
+  _current = 1 - _current;
+
+  // Skills run on the fresh state, as _dispatch_vortex does after the
+  // solver pass
+  if (_vortex.active) {
+    _apply_vortex();
+  }
+  _interactions.clear();
+}
+
+void OceanShallowWater::_step_rows(uint32_t p_band) {
+  int begin = (int)p_band * ROWS_PER_BAND;
+  int end = std::min(begin + ROWS_PER_BAND, _grid_res);
+  for (int y = begin; y < end; y++) {
+    _step_row(y);
+  }
+}
+
+void OceanShallowWater::_step_row(int p_y) {
+  const StepConstants &k = _constants;
+  int n = _grid_res;
+  int up = std::max(p_y - 1, 0) * n;
+  int row = p_y * n;
+  int down = std::min(p_y + 1, n - 1) * n;
+  const float *h_in = _h[_current].data();
+  const float *hu_in = _hu[_current].data();
+  const float *hv_in = _hv[_current].data();
+  Rows h = {h_in + row, h_in + up, h_in + down};
+  Rows hu = {hu_in + row, hu_in + up, hu_in + down};
+  Rows hv = {hv_in + row, hv_in + up, hv_in + down};
+  const float *obstacle = _obstacle.data() + row;
+  float *h_out = _h[1 - _current].data() + row;
+  float *hu_out = _hu[1 - _current].data() + row;
+  float *hv_out = _hv[1 - _current].data() + row;
+
+  // 1. Flux update; the end columns clamp their outer neighbour
+  update_cells<float>(k, h, hu, hv, obstacle, 0, 0, std::min(1, n - 1),
+                      h_out, hu_out, hv_out);
+  int x = 1;
+#ifdef OCEAN_SWE_SSE
+  for (; x + 4 <= n - 1; x += 4) {
+    update_cells<Lanes4>(k, h, hu, hv, obstacle, x, x - 1, x + 1, h_out,
+                         hu_out, hv_out);
+  }
+#endif
+  for (; x < n - 1; x++) {
+    update_cells<float>(k, h, hu, hv, obstacle, x, x - 1, x + 1, h_out,
+                        hu_out, hv_out);
+  }
+  if (n > 1) {
+    update_cells<float>(k, h, hu, hv, obstacle, n - 1, n - 2, n - 1, h_out,
+                        hu_out, hv_out);
+  }
+
+  // 2. Dry cells do not pull water up onto higher neighbours. Rare, so
+  //    checked per cell after the vector pass.
+  for (x = 0; x < n; x++) {
+    float eta = k.depth + h_out[x];
+    if (eta >= H_EPS * 10.0f || obstacle[x] > 0.5f) {
+      continue;
+    }
+    if (eta < k.depth + h.c[std::min(x + 1, n - 1)] * 0.5f)
+      hu_out[x] = std::min(hu_out[x], 0.0f);
+    if (eta < k.depth + h.c[std::max(x - 1, 0)] * 0.5f)
+      hu_out[x] = std::max(hu_out[x], 0.0f);
+    if (eta < k.depth + h.d[x] * 0.5f)
+      hv_out[x] = std::min(hv_out[x], 0.0f);
+    if (eta < k.depth + h.u[x] * 0.5f)
+      hv_out[x] = std::max(hv_out[x], 0.0f);
+  }
+
+  // 3. Rain
+  if (k.rain > 0.0f) {
+    float frame = std::floor(k.time * 60.0f);
+    for (x = 0; x < n; x++) {
+      if (rain_hash(x + frame, p_y + frame) < k.rain * 0.05f) {
+        h_out[x] += 0.5f * k.dt;
+      }
+    }
+  }
+
+  // 4. Interactions that reach this row, in uv like the shader
+  float v = (float)p_y / n;
+  for (const Interaction &it : _interactions) {
+    float dv = v - it.uv.y;
+    if (it.radius <= 0.001f || std::fabs(dv) >= it.radius) {
+      continue;
+    }
+    int x0 = std::max((int)std::floor((it.uv.x - it.radius) * n), 0);
+    int x1 = std::min((int)std::ceil((it.uv.x + it.radius) * n), n - 1);
+    for (x = x0; x <= x1; x++) {
+      float du = (float)x / n - it.uv.x;
+      float dist2 = du * du + dv * dv;
+      if (dist2 >= it.radius * it.radius) {
+        continue;
+      }
+      float gauss = std::exp(-dist2 / (it.radius * it.radius * 0.25f));
+      if (it.injection) {
+        h_out[x] += it.strength * gauss * k.dt;
+      } else if (it.strength > 1000.0f) {
+        hu_out[x] += (it.strength - 2000.0f) * gauss * k.dt * 10.0f;
+      } else if (it.strength < -1000.0f) {
+        h_out[x] += (std::fabs(it.strength) - 2000.0f) * gauss * k.dt;
+      } else {
+        h_out[x] += std::min(std::max(it.strength * gauss * k.dt, -0.5f), 0.5f);
+      }
+    }
+  }
+
+  // 5. Border, clamps and speed limit
+  float row_distance = (float)std::min(p_y, n - 1 - p_y);
+  const float *edge = _edge_distance.data();
+  x = 0;
+#ifdef OCEAN_SWE_SSE
+  for (; x + 4 <= n; x += 4) {
+    finish_cells<Lanes4>(k, edge, row_distance, x, h_out, hu_out, hv_out);
+  }
+#endif
+  for (; x < n; x++) {
+    finish_cells<float>(k, edge, row_distance, x, h_out, hu_out, hv_out);
+  }
+}
+
+void OceanShallowWater::_apply_vortex() {
+  // Vortex.glsl: funnel, spiral arms and edge ripples on the height, and
+  // a Rankine swirl with inward suction replacing the momentum. Like the
+  // shader it maps cells over sea_size.x around the local origin.
+  int n = _grid_res;
+  float world_size = _sea_size.x;
+  const Vortex &vortex = _vortex;
+  const float CORE_RATIO = 0.2f;
+  float *h = _h[_current].data();
+  float *hu = _hu[_current].data();
+  float *hv = _hv[_current].data();
+
+  float to_grid = n / world_size;
+  int x0 = std::max((int)std::floor((vortex.position.x - vortex.radius +
+                                     world_size * 0.5f) *
+                                    to_grid),
+                    0);
+  int x1 = std::min((int)std::ceil((vortex.position.x + vortex.radius +
+                                    world_size * 0.5f) *
+                                   to_grid),
+                    n - 1);
+  int y0 = std::max((int)std::floor((vortex.position.y - vortex.radius +
+                                     world_size * 0.5f) *
+                                    to_grid),
+                    0);
+  int y1 = std::min((int)std::ceil((vortex.position.y + vortex.radius +
+                                    world_size * 0.5f) *
+                                   to_grid),
+                    n - 1);
+  for (int y = y0; y <= y1; y++) {
+    for (int x = x0; x <= x1; x++) {
+      float wx = (float)x / n * world_size - world_size * 0.5f;
+      float wz = (float)y / n * world_size - world_size * 0.5f;
+      float tx = wx - vortex.position.x;
+      float tz = wz - vortex.position.y;
+      float distance = std::sqrt(tx * tx + tz * tz);
+      if (distance > vortex.radius) {
+        continue;
+      }
+      float r = distance / vortex.radius;
+
+      float funnel = 1.0f / (1.0f + (r / 0.15f) * (r / 0.15f));
+      float funnel_depth = funnel * vortex.depth * vortex.intensity;
+      float angle = std::atan2(tz, tx);
+      float spiral = std::sin(4.0f * angle + vortex.speed * _time + r * 15.0f) *
+                     std::exp(-r * 3.0f) * vortex.intensity * 1.2f;
+      float edge_band = (r - CORE_RATIO) / 0.05f;
+      float edge = std::sin(_time * 5.0f + r * 40.0f) *
+                   std::exp(-edge_band * edge_band) * 0.5f;
+      float influence =
+          smoothstep(vortex.radius, vortex.radius * 0.8f, distance);
+      int i = y * n + x;
+      float height = h[i] + (-funnel_depth + spiral + edge) * influence;
+
+      float tangent_speed =
+          (r < CORE_RATIO ? r / CORE_RATIO : CORE_RATIO / r) * vortex.speed *
+          vortex.radius * vortex.intensity;
+      float vx = 0.0f;
+      float vz = 0.0f;
+      if (distance > 0.001f) {
+        float suction = (1.0f - r) * vortex.intensity * 10.0f;
+        vx = -tz / distance * tangent_speed - tx / distance * suction;
+        vz = tx / distance * tangent_speed - tz / distance * suction;
+      }
+      // The shader assumes the default 1 m base depth here
+      float total = std::max(height + 1.0f, 0.01f);
+      h[i] = height;
+      hu[i] = vx * total;
+      hv[i] = vz * total;
+    }
+  }
+}
+
+void OceanShallowWater::reset() {
+  for (int i = 0; i < 2; i++) {
+    std::fill(_h[i].begin(), _h[i].end(), 0.0f);
+    std::fill(_hu[i].begin(), _hu[i].end(), 0.0f);
+    std::fill(_hv[i].begin(), _hv[i].end(), 0.0f);
+  }
+}
+
+Vector2 OceanShallowWater::_world_to_uv(const Vector3 &p_world_pos) const {
+  // Toroidal, as WaterManager._world_to_swe_uv
+  Vector2 uv = (Vector2(p_world_pos.x, p_world_pos.z) - _scroll_origin) /
+                   _sea_size +
+               Vector2(0.5f, 0.5f);
+  uv.x = std::fmod(std::fmod(uv.x, 1.0f) + 1.0f, 1.0f);
+  uv.y = std::fmod(std::fmod(uv.y, 1.0f) + 1.0f, 1.0f);
+  return uv;
+}
+
+float OceanShallowWater::_uv_radius(float p_radius) const {
+  return std::max(p_radius / std::max(_sea_size.x, 1.0f),
+                  2.0f / (float)_grid_res);
+}
+
+void OceanShallowWater::trigger_ripple(const Vector3 &p_world_pos,
+                                       float p_strength, float p_radius) {
+  if ((int)_interactions.size() >= MAX_INTERACTIONS) {
+    return;
+  }
+  Interaction it;
+  it.uv = _world_to_uv(p_world_pos);
+  it.strength = p_strength;
+  it.radius = _uv_radius(p_radius);
+  _interactions.push_back(it);
+}
+
+void OceanShallowWater::trigger_water_injection(const Vector3 &p_world_pos,
+                                                float p_added_height,
+                                                float p_radius) {
+  if ((int)_interactions.size() >= MAX_INTERACTIONS) {
+    return;
+  }
+  Interaction it;
+  it.uv = _world_to_uv(p_world_pos);
+  it.strength = p_added_height;
+  it.radius = _uv_radius(p_radius);
+  it.injection = true;
+  _interactions.push_back(it);
+}
+
+void OceanShallowWater::trigger_vortex(const Vector2 &p_local_pos,
+                                       float p_radius, float p_intensity,
+                                       float p_speed, float p_depth) {
+  _vortex.active = true;
+  _vortex.position = p_local_pos;
+  _vortex.radius = std::max(p_radius, 0.01f);
+  _vortex.intensity = p_intensity;
+  _vortex.speed = p_speed;
+  _vortex.depth = p_depth;
+}
+
+void OceanShallowWater::clear_vortex() { _vortex.active = false; }
+
+void OceanShallowWater::update_scroll(const Vector3 &p_center) {
+  Vector2 cell = _sea_size / (float)_grid_res;
+  Vector2 offset =
+      (Vector2(p_center.x, p_center.z) - _scroll_origin) / cell;
+  // Whole cells only, truncated like the GDScript int()
+  int shift_x = (int)offset.x;
+  int shift_y = (int)offset.y;
+  if (shift_x == 0 && shift_y == 0) {
+    return;
+  }
+  _scroll_origin += Vector2((float)shift_x * cell.x, (float)shift_y * cell.y);
+}
+
+void OceanShallowWater::set_scroll_origin(const Vector2 &p_origin) {
+  _scroll_origin = p_origin;
+}
+Vector2 OceanShallowWater::get_scroll_origin() const { return _scroll_origin; }
+
+float OceanShallowWater::get_height_at(const Vector3 &p_world_pos) const {
+  int n = _grid_res;
+  Vector2 uv = _world_to_uv(p_world_pos);
+  // Texel centres at (i + 0.5) / n, wrapping like the uv
+  float fx = uv.x * n - 0.5f;
+  float fy = uv.y * n - 0.5f;
+  int x0 = (int)std::floor(fx);
+  int y0 = (int)std::floor(fy);
+  float tx = fx - x0;
+  float ty = fy - y0;
+  int x1 = (x0 + 1) % n;
+  int y1 = (y0 + 1) % n;
+  x0 = (x0 + n) % n;
+  y0 = (y0 + n) % n;
+  const float *h = _h[_current].data();
+  float top = h[y0 * n + x0] + (h[y0 * n + x1] - h[y0 * n + x0]) * tx;
+  float bottom = h[y1 * n + x0] + (h[y1 * n + x1] - h[y1 * n + x0]) * tx;
+  return top + (bottom - top) * ty;
+}
+
+PackedFloat32Array OceanShallowWater::get_height_buffer() const {
+  PackedFloat32Array result;
+  result.resize(_h[_current].size());
+  std::copy(_h[_current].begin(), _h[_current].end(), result.ptrw());
+  return result;
+}
+
+PackedByteArray OceanShallowWater::get_state_buffer() const {
+  int cells = _grid_res * _grid_res;
+  PackedByteArray result;
+  result.resize(cells * 4 * sizeof(float));
+  float *out = (float *)result.ptrw();
+  const float *h = _h[_current].data();
+  const float *hu = _hu[_current].data();
+  const float *hv = _hv[_current].data();
+  for (int i = 0; i < cells; i++) {
+    out[i * 4 + 0] = h[i];
+    out[i * 4 + 1] = hu[i];
+    out[i * 4 + 2] = hv[i];
+    out[i * 4 + 3] = _obstacle[i];
+  }
+  return result;
+}
+
+void OceanShallowWater::set_obstacle_mask(const PackedByteArray &p_mask) {
+  ERR_FAIL_COND_MSG((int)p_mask.size() != _grid_res * _grid_res,
+                    "Obstacle mask must hold grid_res * grid_res bytes.");
+  const uint8_t *mask = p_mask.ptr();
+  for (int i = 0; i < (int)_obstacle.size(); i++) {
+    _obstacle[i] = mask[i] > 127 ? 1.0f : 0.0f;
+  }
+}
+
+PackedByteArray OceanShallowWater::get_obstacle_mask() const {
+  PackedByteArray result;
+  result.resize(_obstacle.size());
+  uint8_t *out = result.ptrw();
+  for (int i = 0; i < (int)_obstacle.size(); i++) {
+    out[i] = _obstacle[i] > 0.5f ? 255 : 0;
+  }
+  return result;
+}
+
+void OceanShallowWater::set_grid_res(int p_res) {
+  ERR_FAIL_COND_MSG(p_res < 8, "grid_res must be at least 8.");
+  if (p_res == _grid_res) {
+    return;
+  }
+  _grid_res = p_res;
+  _allocate();
+}
+int OceanShallowWater::get_grid_res() const { return _grid_res; }
+
+void OceanShallowWater::set_sea_size(const Vector2 &p_size) {
+  _sea_size = p_size;
+}
+Vector2 OceanShallowWater::get_sea_size() const { return _sea_size; }
+
+void OceanShallowWater::set_damping(float p_damping) { _damping = p_damping; }
+float OceanShallowWater::get_damping() const { return _damping; }
+
+void OceanShallowWater::set_gravity(float p_gravity) { _gravity = p_gravity; }
+float OceanShallowWater::get_gravity() const { return _gravity; }
+
+void OceanShallowWater::set_base_depth(float p_depth) { _base_depth = p_depth; }
+float OceanShallowWater::get_base_depth() const { return _base_depth; }
+
+void OceanShallowWater::set_rain_intensity(float p_intensity) {
+  _rain_intensity = p_intensity;
+}
+float OceanShallowWater::get_rain_intensity() const { return _rain_intensity; }
+
+void OceanShallowWater::set_use_threads(bool p_enabled) {
+  _use_threads = p_enabled;
+}
+bool OceanShallowWater::get_use_threads() const { return _use_threads; }
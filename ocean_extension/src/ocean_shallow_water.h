@@ -0,0 +1,150 @@
+#ifndef OCEAN_SHALLOW_WATER_H
+#define OCEAN_SHALLOW_WATER_H
+
+#include <godot_cpp/classes/ref_counted.hpp>
+#include <godot_cpp/core/class_db.hpp>
+#include <godot_cpp/variant/packed_byte_array.hpp>
+#include <godot_cpp/variant/packed_float32_array.hpp>
+#include <godot_cpp/variant/vector2.hpp>
+#include <godot_cpp/variant/vector3.hpp>
+
+#include <vector>
+
+namespace godot {
+
+// CPU port of WaterManager's interaction solver (water_interaction.glsl
+// and Vortex.glsl) for servers and machines without compute shaders.
+// Same Lax-Friedrichs scheme, clamped edges, absorbing border, dry-wet
+// handling and interaction modes, on the same grid_res x grid_res grid
+// over sea_size with the same scrolling origin, so a server and its GPU
+// clients agree on the water.
+//
+// Rows are split across the WorkerThreadPool; each row is updated four
+// cells at a time with SSE where available.
+class OceanShallowWater : public RefCounted {
+  GDCLASS(OceanShallowWater, RefCounted)
+
+public:
+  // Same cap as WaterManager.MAX_INTERACTIONS
+  static const int MAX_INTERACTIONS = 128;
+
+  // Per step values shared by every row
+  struct StepConstants {
+    float dt = 0.0f;
+    float damping = 0.0f;
+    float gravity = 0.0f;
+    float depth = 0.0f;
+    float rain = 0.0f;
+    float time = 0.0f;
+    int margin = 0; // absorbing border, cells
+  };
+
+private:
+  struct Interaction {
+    Vector2 uv;
+    float strength = 0.0f;
+    float radius = 0.0f; // uv
+    bool injection = false;
+  };
+
+  struct Vortex {
+    bool active = false;
+    Vector2 position; // local xz
+    float radius = 10.0f;
+    float intensity = 1.0f;
+    float speed = 2.0f;
+    float depth = 5.0f;
+  };
+
+  int _grid_res = 128;
+  Vector2 _sea_size = Vector2(80.0f, 80.0f);
+  float _damping = 0.8f;
+  float _gravity = 9.81f;
+  float _base_depth = 1.0f;
+  float _rain_intensity = 0.0f;
+  bool _use_threads = true;
+  float _time = 0.0f;
+  Vector2 _scroll_origin;
+
+  // State, double buffered: _current is read, the other written
+  std::vector<float> _h[2], _hu[2], _hv[2];
+  int _current = 0;
+  std::vector<float> _obstacle; // 1 solid, 0 water
+  // Distance of each column to the nearer side, for the border
+  std::vector<float> _edge_distance;
+
+  std::vector<Interaction> _interactions;
+  Vortex _vortex;
+  StepConstants _constants;
+
+  void _allocate();
+  void _step_rows(uint32_t p_band);
+  void _step_row(int p_y);
+  void _apply_vortex();
+  Vector2 _world_to_uv(const Vector3 &p_world_pos) const;
+  float _uv_radius(float p_radius) const;
+
+protected:
+  static void _bind_methods();
+
+public:
+  OceanShallowWater();
+  ~OceanShallowWater();
+
+  // One solver step; dt is capped at 0.02 s like WaterManager._run_compute
+  void step(float p_delta);
+  // Clears height and momentum, keeps obstacles
+  void reset();
+
+  // Interactions are applied and cleared by the next step, as the
+  // interaction buffer is on the GPU
+  void trigger_ripple(const Vector3 &p_world_pos, float p_strength,
+                      float p_radius);
+  void trigger_water_injection(const Vector3 &p_world_pos,
+                               float p_added_height, float p_radius);
+  void trigger_vortex(const Vector2 &p_local_pos, float p_radius,
+                      float p_intensity, float p_speed, float p_depth);
+  void clear_vortex();
+
+  // Moves the origin in whole cells towards p_center, like
+  // WaterManager._update_swe_scroll
+  void update_scroll(const Vector3 &p_center);
+  void set_scroll_origin(const Vector2 &p_origin);
+  Vector2 get_scroll_origin() const;
+
+  // Water height (m, relative to rest) at a world point, bilinear
+  float get_height_at(const Vector3 &p_world_pos) const;
+  // grid_res^2 heights, row major
+  PackedFloat32Array get_height_buffer() const;
+  // grid_res^2 RGBA float texels (h, hu, hv, obstacle), the layout of
+  // WaterManager's sim textures, ready for texture_update
+  PackedByteArray get_state_buffer() const;
+  // grid_res^2 bytes, above 127 is solid
+  void set_obstacle_mask(const PackedByteArray &p_mask);
+  PackedByteArray get_obstacle_mask() const;
+
+  void set_grid_res(int p_res);
+  int get_grid_res() const;
+
+  void set_sea_size(const Vector2 &p_size);
+  Vector2 get_sea_size() const;
+
+  void set_damping(float p_damping);
+  float get_damping() const;
+
+  void set_gravity(float p_gravity);
+  float get_gravity() const;
+
+  void set_base_depth(float p_depth);
+  float get_base_depth() const;
+
+  void set_rain_intensity(float p_intensity);
+  float get_rain_intensity() const;
+
+  void set_use_threads(bool p_enabled);
+  bool get_use_threads() const;
+};
+
+} // namespace godot
+
+#endif
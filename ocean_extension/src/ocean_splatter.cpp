@@ -0,0 +1,287 @@
+#include "ocean_splatter.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <godot_cpp/classes/image.hpp>
+#include <godot_cpp/core/class_db.hpp>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define OCEAN_SPLAT_SSE 1
+#include <immintrin.h>
+#endif
+
+using namespace godot;
+
+namespace {
+
+// The ripple shader adds this to r^2 so tiny radii stay finite
+const float GAUSSIAN_RADIUS_EPS = 0.0001f;
+// The Gaussian is cut off at this many radii (exp(-9) ~ 1e-4)
+const float GAUSSIAN_EXTENT = 3.0f;
+
+// r_row[i] += p_scale * p_weights[i], clamped to [0, 1] when saturating
+void add_scaled(float *r_row, const float *p_weights, int p_count,
+                float p_scale, bool p_saturate) {
+  int i = 0;
+#ifdef OCEAN_SPLAT_SSE
+  __m128 scale = _mm_set1_ps(p_scale);
+  __m128 zero = _mm_setzero_ps();
+  __m128 one = _mm_set1_ps(1.0f);
+  for (; i + 4 <= p_count; i += 4) {
+    __m128 value = _mm_add_ps(_mm_loadu_ps(r_row + i),
+                              _mm_mul_ps(scale, _mm_loadu_ps(p_weights + i)));
+    if (p_saturate) {
+      value = _mm_min_ps(_mm_max_ps(value, zero), one);
+    }
+    _mm_storeu_ps(r_row + i, value);
+  }
+#endif
+  for (; i < p_count; i++) {
+    float value = r_row[i] + p_scale * p_weights[i];
+    r_row[i] = p_saturate ? std::min(std::max(value, 0.0f), 1.0f) : value;
+  }
+}
+
+// Pixel range whose centres (i + 0.5) / p_count lie within
+// [p_center - p_extent, p_center + p_extent], clipped to the buffer
+void covered_range(float p_center, float p_extent, int p_count, int &r_begin,
+                   int &r_end) {
+  r_begin = std::max((int)std::ceil((p_center - p_extent) * p_count - 0.5f), 0);
+  r_end = std::min((int)std::floor((p_center + p_extent) * p_count - 0.5f),
+                   p_count - 1);
+}
+
+} // namespace
+
+void OceanSplatter::_bind_methods() {
+  BIND_ENUM_CONSTANT(FALLOFF_GAUSSIAN);
+  BIND_ENUM_CONSTANT(FALLOFF_SMOOTHSTEP);
+
+  ClassDB::bind_method(D_METHOD("splat", "p_uv", "p_intensity", "p_radius"),
+                       &OceanSplatter::splat);
+  ClassDB::bind_method(D_METHOD("splat_batch", "p_stamps"),
+                       &OceanSplatter::splat_batch);
+  ClassDB::bind_method(D_METHOD("clear"), &OceanSplatter::clear);
+  ClassDB::bind_method(D_METHOD("get_dirty_rect"),
+                       &OceanSplatter::get_dirty_rect);
+  ClassDB::bind_method(D_METHOD("get_data"), &OceanSplatter::get_data);
+  ClassDB::bind_method(D_METHOD("update_texture", "p_texture"),
+                       &OceanSplatter::update_texture);
+  ClassDB::bind_method(D_METHOD("create_texture"),
+                       &OceanSplatter::create_texture);
+
+  ClassDB::bind_method(D_METHOD("get_size"), &OceanSplatter::get_size);
+  ClassDB::bind_method(D_METHOD("set_size", "p_size"),
+                       &OceanSplatter::set_size);
+  ClassDB::add_property("OceanSplatter", PropertyInfo(Variant::VECTOR2I, "size"),
+                        "set_size", "get_size");
+
+  ClassDB::bind_method(D_METHOD("get_falloff"), &OceanSplatter::get_falloff);
+  ClassDB::bind_method(D_METHOD("set_falloff", "p_falloff"),
+                       &OceanSplatter::set_falloff);
+  ClassDB::add_property("OceanSplatter",
+                        PropertyInfo(Variant::INT, "falloff",
+                                     PROPERTY_HINT_ENUM, "Gaussian,Smoothstep"),
+                        "set_falloff", "get_falloff");
+
+  ClassDB::bind_method(D_METHOD("get_saturate"), &OceanSplatter::get_saturate);
+  ClassDB::bind_method(D_METHOD("set_saturate", "p_enabled"),
+                       &OceanSplatter::set_saturate);
+  ClassDB::add_property("OceanSplatter", PropertyInfo(Variant::BOOL, "saturate"),
+                        "set_saturate", "get_saturate");
+}
+
+OceanSplatter::OceanSplatter() { _allocate(); }
+OceanSplatter::~OceanSplatter() {}
+
+void OceanSplatter::_allocate() {
+  _buffer.assign(_size.x * _size.y, 0.0f);
+  _column_weights.resize(_size.x);
+  _written = Rect2i();
+  _dirty = Rect2i();
+  _image.unref();
+}
+
+void OceanSplatter::_upload_rows(int p_begin, int p_end) {
+  if (_image.is_null()) {
+    // Created once per size; owns its pixels, so writing them in place
+    // never copies
+    PackedByteArray zeros;
+    zeros.resize(_buffer.size() * sizeof(float));
+    _image = Image::create_from_data(_size.x, _size.y, false,
+                                     Image::FORMAT_RF, zeros);
+    p_begin = 0;
+    p_end = _size.y;
+  }
+  memcpy(_image->ptrw() + (size_t)p_begin * _size.x * sizeof(float),
+         _buffer.data() + (size_t)p_begin * _size.x,
+         (size_t)(p_end - p_begin) * _size.x * sizeof(float));
+}
+
+void OceanSplatter::_touch(const Rect2i &p_rect) {
+  // merge() would stretch an empty rect to the origin
+  _written = _written.has_area() ? _written.merge(p_rect) : p_rect;
+  _dirty = _dirty.has_area() ? _dirty.merge(p_rect) : p_rect;
+}
+
+void OceanSplatter::_splat_gaussian(float p_u, float p_v, float p_intensity,
+                                    float p_radius) {
+  // exp(-(dx^2 + dy^2) / r^2) = exp(-dx^2 / r^2) * exp(-dy^2 / r^2): one
+  // exp per column and row, then a multiply-add per pixel
+  float r2 = p_radius * p_radius + GAUSSIAN_RADIUS_EPS;
+  float extent = GAUSSIAN_EXTENT * std::sqrt(r2);
+  int x0, x1, y0, y1;
+  covered_range(p_u, extent, _size.x, x0, x1);
+  covered_range(p_v, extent, _size.y, y0, y1);
+  if (x0 > x1 || y0 > y1) {
+    return;
+  }
+
+  float inv_r2 = 1.0f / r2;
+  float *weights = _column_weights.data();
+  for (int x = x0; x <= x1; x++) {
+    float dx = (x + 0.5f) / _size.x - p_u;
+    weights[x - x0] = std::exp(-dx * dx * inv_r2);
+  }
+  for (int y = y0; y <= y1; y++) {
+    float dy = (y + 0.5f) / _size.y - p_v;
+    float scale = p_intensity * std::exp(-dy * dy * inv_r2);
+    add_scaled(_buffer.data() + y * _size.x + x0, weights, x1 - x0 + 1, scale,
+               _saturate);
+  }
+  _touch(Rect2i(x0, y0, x1 - x0 + 1, y1 - y0 + 1));
+}
+
+void OceanSplatter::_splat_smoothstep(float p_u, float p_v, float p_intensity,
+                                      float p_radius) {
+  if (p_radius <= 0.0f) {
+    return;
+  }
+  int x0, x1, y0, y1;
+  covered_range(p_u, p_radius, _size.x, x0, x1);
+  covered_range(p_v, p_radius, _size.y, y0, y1);
+  if (x0 > x1 || y0 > y1) {
+    return;
+  }
+
+  float amount = p_intensity * 0.5f;
+  float inv_radius = 1.0f / p_radius;
+  float step = 1.0f / _size.x;
+  float dx0 = (x0 + 0.5f) * step - p_u;
+  for (int y = y0; y <= y1; y++) {
+    float dy = (y + 0.5f) / _size.y - p_v;
+    float dy2 = dy * dy;
+    float *row = _buffer.data() + y * _size.x;
+    int x = x0;
+#ifdef OCEAN_SPLAT_SSE
+    __m128i lanes = _mm_set_epi32(3, 2, 1, 0);
+    __m128 zero = _mm_setzero_ps();
+    __m128 one = _mm_set1_ps(1.0f);
+    for (; x + 4 <= x1 + 1; x += 4) {
+      // dx0 + (x - x0) * step per lane, as the scalar tail computes it, so
+      // a pixel gets the same value whichever path writes it
+      __m128 lane_dx = _mm_add_ps(
+          _mm_set1_ps(dx0),
+          _mm_mul_ps(_mm_cvtepi32_ps(
+                         _mm_add_epi32(_mm_set1_epi32(x - x0), lanes)),
+                     _mm_set1_ps(step)));
+      __m128 d = _mm_sqrt_ps(
+          _mm_add_ps(_mm_mul_ps(lane_dx, lane_dx), _mm_set1_ps(dy2)));
+      __m128 t = _mm_min_ps(_mm_mul_ps(d, _mm_set1_ps(inv_radius)), one);
+      // 1 - t^2 (3 - 2t)
+      __m128 falloff = _mm_sub_ps(
+          one, _mm_mul_ps(_mm_mul_ps(t, t),
+                          _mm_sub_ps(_mm_set1_ps(3.0f),
+                                     _mm_add_ps(t, t))));
+      __m128 value = _mm_add_ps(_mm_loadu_ps(row + x),
+                                _mm_mul_ps(_mm_set1_ps(amount), falloff));
+      if (_saturate) {
+        value = _mm_min_ps(_mm_max_ps(value, zero), one);
+      }
+      _mm_storeu_ps(row + x, value);
+    }
+#endif
+    for (; x <= x1; x++) {
+      float dx = dx0 + (float)(x - x0) * step;
+      float t = std::min(std::sqrt(dx * dx + dy2) * inv_radius, 1.0f);
+      float value = row[x] + amount * (1.0f - t * t * (3.0f - 2.0f * t));
+      row[x] = _saturate ? std::min(std::max(value, 0.0f), 1.0f) : value;
+    }
+  }
+  _touch(Rect2i(x0, y0, x1 - x0 + 1, y1 - y0 + 1));
+}
+
+void OceanSplatter::splat(const Vector2 &p_uv, float p_intensity,
+                          float p_radius) {
+  if (_falloff == FALLOFF_GAUSSIAN) {
+    _splat_gaussian(p_uv.x, p_uv.y, p_intensity, p_radius);
+  } else {
+    _splat_smoothstep(p_uv.x, p_uv.y, p_intensity, p_radius);
+  }
+}
+
+void OceanSplatter::splat_batch(const PackedVector4Array &p_stamps) {
+  const Vector4 *stamps = p_stamps.ptr();
+  for (int i = 0; i < (int)p_stamps.size(); i++) {
+    splat(Vector2(stamps[i].x, stamps[i].y), stamps[i].z, stamps[i].w);
+  }
+}
+
+void OceanSplatter::clear() {
+  if (!_written.has_area()) {
+    return;
+  }
+  for (int y = _written.position.y; y < _written.get_end().y; y++) {
+    float *row = _buffer.data() + y * _size.x + _written.position.x;
+    std::fill(row, row + _written.size.x, 0.0f);
+  }
+  // The zeros still have to reach the texture
+  _dirty = _dirty.has_area() ? _dirty.merge(_written) : _written;
+  _written = Rect2i();
+}
+
+Rect2i OceanSplatter::get_dirty_rect() const { return _dirty; }
+
+PackedByteArray OceanSplatter::get_data() const {
+  PackedByteArray result;
+  result.resize(_buffer.size() * sizeof(float));
+  memcpy(result.ptrw(), _buffer.data(), _buffer.size() * sizeof(float));
+  return result;
+}
+
+bool OceanSplatter::update_texture(const Ref<ImageTexture> &p_texture) {
+  ERR_FAIL_COND_V_MSG(p_texture.is_null(), false, "Texture is null.");
+  ERR_FAIL_COND_V_MSG(p_texture->get_width() != _size.x ||
+                          p_texture->get_height() != _size.y,
+                      false, "Texture size does not match the splat buffer.");
+  if (!_dirty.has_area()) {
+    return false;
+  }
+  _upload_rows(_dirty.position.y, _dirty.get_end().y);
+  p_texture->update(_image);
+  _dirty = Rect2i();
+  return true;
+}
+
+Ref<ImageTexture> OceanSplatter::create_texture() {
+  _upload_rows(0, _size.y);
+  _dirty = Rect2i();
+  return ImageTexture::create_from_image(_image);
+}
+
+void OceanSplatter::set_size(const Vector2i &p_size) {
+  ERR_FAIL_COND_MSG(p_size.x < 1 || p_size.y < 1,
+                    "Splat buffer size must be positive.");
+  if (p_size == _size) {
+    return;
+  }
+  _size = p_size;
+  _allocate();
+}
+Vector2i OceanSplatter::get_size() const { return _size; }
+
+void OceanSplatter::set_falloff(Falloff p_falloff) { _falloff = p_falloff; }
+OceanSplatter::Falloff OceanSplatter::get_falloff() const { return _falloff; }
+
+void OceanSplatter::set_saturate(bool p_enabled) { _saturate = p_enabled; }
+bool OceanSplatter::get_saturate() const { return _saturate; }
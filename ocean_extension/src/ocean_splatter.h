@@ -0,0 +1,98 @@
+#ifndef OCEAN_SPLATTER_H
+#define OCEAN_SPLATTER_H
+
+#include <godot_cpp/classes/image.hpp>
+#include <godot_cpp/classes/image_texture.hpp>
+#include <godot_cpp/classes/ref_counted.hpp>
+#include <godot_cpp/core/class_db.hpp>
+#include <godot_cpp/variant/packed_byte_array.hpp>
+#include <godot_cpp/variant/packed_vector4_array.hpp>
+#include <godot_cpp/variant/rect2i.hpp>
+#include <godot_cpp/variant/vector2.hpp>
+#include <godot_cpp/variant/vector2i.hpp>
+
+#include <vector>
+
+namespace godot {
+
+// Accumulates soft round stamps (ripple impulses, foam) into a
+// persistent single channel float buffer and uploads it as an RF image,
+// replacing per pixel Image writes from GDScript. Stamps are given in uv
+// with the radius as a fraction of the width, like the impulses of
+// local_ripple_sim.gdshader.
+//
+// Rows are written four pixels at a time with SSE where available. The
+// buffer tracks what was written since the last clear and what changed
+// since the last upload, so clearing is limited to the touched area and
+// an idle frame uploads nothing.
+class OceanSplatter : public RefCounted {
+  GDCLASS(OceanSplatter, RefCounted)
+
+public:
+  enum Falloff {
+    // intensity * exp(-d^2 / r^2), the ripple impulse
+    FALLOFF_GAUSSIAN,
+    // intensity * 0.5 * (1 - smoothstep(0, r, d)), the foam splat
+    FALLOFF_SMOOTHSTEP,
+  };
+
+private:
+  Vector2i _size = Vector2i(256, 256);
+  Falloff _falloff = FALLOFF_GAUSSIAN;
+  bool _saturate = false; // clamp to [0, 1] after each stamp
+
+  std::vector<float> _buffer;
+  // Scratch for the separable Gaussian, one weight per column
+  std::vector<float> _column_weights;
+  Rect2i _written; // non-zero area since the last clear
+  Rect2i _dirty;   // changed area since the last upload
+  // Staging image for uploads, kept between frames
+  Ref<Image> _image;
+
+  void _allocate();
+  void _splat_gaussian(float p_u, float p_v, float p_intensity,
+                       float p_radius);
+  void _splat_smoothstep(float p_u, float p_v, float p_intensity,
+                         float p_radius);
+  void _touch(const Rect2i &p_rect);
+  // Copies buffer rows [p_begin, p_end) into _image, creating it if needed
+  void _upload_rows(int p_begin, int p_end);
+
+protected:
+  static void _bind_methods();
+
+public:
+  OceanSplatter();
+  ~OceanSplatter();
+
+  void splat(const Vector2 &p_uv, float p_intensity, float p_radius);
+  // (u, v, intensity, radius) per stamp
+  void splat_batch(const PackedVector4Array &p_stamps);
+  // Zeroes the written area
+  void clear();
+
+  // Area changed since the last upload; empty when there is nothing new
+  Rect2i get_dirty_rect() const;
+  // Whole buffer as RF texel bytes
+  PackedByteArray get_data() const;
+  // Updates p_texture (an RF image of the same size) if anything
+  // changed; returns whether it did
+  bool update_texture(const Ref<ImageTexture> &p_texture);
+  // New RF ImageTexture holding the current buffer
+  Ref<ImageTexture> create_texture();
+
+  void set_size(const Vector2i &p_size);
+  Vector2i get_size() const;
+
+  void set_falloff(Falloff p_falloff);
+  Falloff get_falloff() const;
+
+  void set_saturate(bool p_enabled);
+  bool get_saturate() const;
+};
+
+} // namespace godot
+
+VARIANT_ENUM_CAST(OceanSplatter::Falloff);
+
+#endif
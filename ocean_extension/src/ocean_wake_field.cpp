@@ -0,0 +1,397 @@
+#include "ocean_wake_field.h"
+#include <algorithm>
+#include <cmath>
+#include <godot_cpp/core/class_db.hpp>
+#include <godot_cpp/core/object.hpp>
+
+using namespace godot;
+
+// Pattern constants shared with kelvin_wake_height() in the surface shader
+static const float WAKE_GRAVITY = 9.81f;
+static const float WAKE_MIN_SPEED = 0.5f;   // m/s, slower sources leave none
+static const float WAKE_HALF_ANGLE = 0.42f; // across / behind at the V edge
+
+static float smoothstep(float p_from, float p_to, float p_value) {
+  float t = std::min(std::max((p_value - p_from) / (p_to - p_from), 0.0f), 1.0f);
+  return t * t * (3.0f - 2.0f * t);
+}
+
+static float move_toward(float p_from, float p_to, float p_delta) {
+  if (std::fabs(p_to - p_from) <= p_delta) {
+    return p_to;
+  }
+  return p_from + (p_to > p_from ? p_delta : -p_delta);
+}
+
+void OceanWakeField::_bind_methods() {
+  ClassDB::bind_method(D_METHOD("register_source", "p_node", "p_strength"),
+                       &OceanWakeField::register_source, DEFVAL(1.0f));
+  ClassDB::bind_method(D_METHOD("unregister_source", "p_node"),
+                       &OceanWakeField::unregister_source);
+  ClassDB::bind_method(D_METHOD("get_source_count"),
+                       &OceanWakeField::get_source_count);
+  ClassDB::bind_method(D_METHOD("get_wake_heights", "p_positions"),
+                       &OceanWakeField::get_wake_heights);
+  ClassDB::bind_method(D_METHOD("get_wake_velocities", "p_positions"),
+                       &OceanWakeField::get_wake_velocities);
+
+  ClassDB::bind_method(D_METHOD("get_max_wake_length"),
+                       &OceanWakeField::get_max_wake_length);
+  ClassDB::bind_method(D_METHOD("set_max_wake_length", "p_length"),
+                       &OceanWakeField::set_max_wake_length);
+  ClassDB::add_property("OceanWakeField",
+                        PropertyInfo(Variant::FLOAT, "max_wake_length"),
+                        "set_max_wake_length", "get_max_wake_length");
+
+  ClassDB::bind_method(D_METHOD("get_path_spacing"),
+                       &OceanWakeField::get_path_spacing);
+  ClassDB::bind_method(D_METHOD("set_path_spacing", "p_spacing"),
+                       &OceanWakeField::set_path_spacing);
+  ClassDB::add_property("OceanWakeField",
+                        PropertyInfo(Variant::FLOAT, "path_spacing"),
+                        "set_path_spacing", "get_path_spacing");
+
+  ClassDB::bind_method(D_METHOD("get_cell_size"),
+                       &OceanWakeField::get_cell_size);
+  ClassDB::bind_method(D_METHOD("set_cell_size", "p_size"),
+                       &OceanWakeField::set_cell_size);
+  ClassDB::add_property("OceanWakeField",
+                        PropertyInfo(Variant::FLOAT, "cell_size"),
+                        "set_cell_size", "get_cell_size");
+}
+
+OceanWakeField::OceanWakeField() { set_physics_process(true); }
+OceanWakeField::~OceanWakeField() {}
+
+int OceanWakeField::_find_source(uint64_t p_node_id) const {
+  for (int i = 0; i < (int)_sources.size(); i++) {
+    if (_sources[i].node_id == p_node_id) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+void OceanWakeField::register_source(Node3D *p_node, float p_strength) {
+  ERR_FAIL_NULL(p_node);
+  if (_find_source(p_node->get_instance_id()) >= 0) {
+    return;
+  }
+  Source source;
+  source.node_id = p_node->get_instance_id();
+  source.strength = p_strength;
+  source.last_position = p_node->get_global_position();
+  _sources.push_back(source);
+}
+
+void OceanWakeField::unregister_source(Node3D *p_node) {
+  ERR_FAIL_NULL(p_node);
+  int index = _find_source(p_node->get_instance_id());
+  if (index < 0) {
+    return;
+  }
+  _sources[index] = _sources.back();
+  _sources.pop_back();
+  _rebuild_bins();
+}
+
+int OceanWakeField::get_source_count() const { return (int)_sources.size(); }
+
+void OceanWakeField::_physics_process(double delta) {
+  float dt = std::max((float)delta, 0.001f);
+  for (int i = (int)_sources.size() - 1; i >= 0; i--) {
+    Node3D *node =
+        Object::cast_to<Node3D>(ObjectDB::get_instance(_sources[i].node_id));
+    if (!node) {
+      // Freed without unregistering
+      _sources[i] = _sources.back();
+      _sources.pop_back();
+      continue;
+    }
+    _update_source(_sources[i], node->get_global_position(), dt);
+  }
+  _rebuild_bins();
+}
+
+void OceanWakeField::_update_source(Source &r_source,
+                                    const Vector3 &p_position, float p_delta) {
+  // Strength and speed ramp as in WaterManager._update_kelvin_wake_shader,
+  // so the physical wake matches the drawn one
+  Vector3 step = p_position - r_source.last_position;
+  float speed = step.length() / p_delta;
+  float step_xz = std::sqrt(step.x * step.x + step.z * step.z);
+  if (step_xz > 0.001f) {
+    r_source.dir_x = step.x / step_xz;
+    r_source.dir_z = step.z / step_xz;
+  } else {
+    speed = 0.0f;
+  }
+  float target = speed > WAKE_MIN_SPEED ? r_source.strength : 0.0f;
+  float rate = target > r_source.active_strength ? 3.0f : 1.5f;
+  r_source.active_strength =
+      move_toward(r_source.active_strength, target, p_delta * rate);
+  if (speed > WAKE_MIN_SPEED) {
+    r_source.speed = speed;
+  } else {
+    r_source.speed = move_toward(r_source.speed, 0.0f, p_delta * 4.0f);
+  }
+  r_source.wake_length =
+      std::min(std::max(r_source.speed * 1.5f, 4.0f), _max_wake_length);
+  r_source.last_position = p_position;
+
+  // Path history: enough points to cover the longest wake
+  int capacity = (int)std::ceil(_max_wake_length / _path_spacing) + 2;
+  if ((int)r_source.path.size() != capacity) {
+    r_source.path.assign(capacity, PathPoint());
+    r_source.path_head = 0;
+    r_source.path_count = 0;
+  }
+  if (r_source.path_count > 0) {
+    const PathPoint &newest = r_source.path[r_source.path_head];
+    float dx = p_position.x - newest.x;
+    float dz = p_position.z - newest.z;
+    if (dx * dx + dz * dz < _path_spacing * _path_spacing) {
+      return;
+    }
+  }
+  r_source.path_head = (r_source.path_head + 1) % capacity;
+  r_source.path[r_source.path_head] = {p_position.x, p_position.z};
+  r_source.path_count = std::min(r_source.path_count + 1, capacity);
+}
+
+uint64_t OceanWakeField::_cell_key(int p_x, int p_z) const {
+  return ((uint64_t)(uint32_t)p_x << 32) | (uint32_t)p_z;
+}
+
+void OceanWakeField::_rebuild_bins() {
+  _bins.clear();
+  float inv_cell = 1.0f / _cell_size;
+  for (int i = 0; i < (int)_sources.size(); i++) {
+    const Source &source = _sources[i];
+    if (source.active_strength <= 0.01f || source.speed < WAKE_MIN_SPEED) {
+      continue;
+    }
+    // Bounds of the wake: the path it lies along, its straight extension
+    // past the oldest point, and the V's half-width at full length
+    float min_x = source.last_position.x;
+    float max_x = min_x;
+    float min_z = source.last_position.z;
+    float max_z = min_z;
+    int capacity = (int)source.path.size();
+    for (int k = 0; k < source.path_count; k++) {
+      const PathPoint &point =
+          source.path[(source.path_head - k + capacity) % capacity];
+      min_x = std::min(min_x, point.x);
+      max_x = std::max(max_x, point.x);
+      min_z = std::min(min_z, point.z);
+      max_z = std::max(max_z, point.z);
+    }
+    float tail_x = source.last_position.x - source.dir_x * source.wake_length;
+    float tail_z = source.last_position.z - source.dir_z * source.wake_length;
+    min_x = std::min(min_x, tail_x);
+    max_x = std::max(max_x, tail_x);
+    min_z = std::min(min_z, tail_z);
+    max_z = std::max(max_z, tail_z);
+    float margin = WAKE_HALF_ANGLE * source.wake_length;
+
+    int x0 = (int)std::floor((min_x - margin) * inv_cell);
+    int x1 = (int)std::floor((max_x + margin) * inv_cell);
+    int z0 = (int)std::floor((min_z - margin) * inv_cell);
+    int z1 = (int)std::floor((max_z + margin) * inv_cell);
+    for (int cx = x0; cx <= x1; cx++) {
+      for (int cz = z0; cz <= z1; cz++) {
+        _bins.push_back({_cell_key(cx, cz), i});
+      }
+    }
+  }
+  std::sort(_bins.begin(), _bins.end());
+}
+
+void OceanWakeField::_accumulate(int p_index, float p_x, float p_z,
+                                 float &r_height, Vector3 &r_velocity) const {
+  const Source &source = _sources[p_index];
+  float speed = source.active_strength > 0.01f ? source.speed : 0.0f;
+  if (speed < WAKE_MIN_SPEED) {
+    return;
+  }
+  float wake_length = source.wake_length;
+
+  // Nearest point on the travelled path, walking back from the source.
+  // The last segment runs on straight, so a path shorter than the wake
+  // (just started, or history trimmed) still has a full V.
+  float best_across = INFINITY;
+  float best_behind = 0.0f;
+  float dir_x = source.dir_x; // travel direction at the nearest point
+  float dir_z = source.dir_z;
+  float side_x = 0.0f; // from the path towards the query point
+  float side_z = 0.0f;
+  float ax = source.last_position.x;
+  float az = source.last_position.z;
+  float ux = -source.dir_x;
+  float uz = -source.dir_z;
+  float travelled = 0.0f;
+  int capacity = (int)source.path.size();
+  for (int k = 0; k <= source.path_count && travelled < wake_length; k++) {
+    float length;
+    if (k < source.path_count) {
+      const PathPoint &b =
+          source.path[(source.path_head - k + capacity) % capacity];
+      float sx = b.x - ax;
+      float sz = b.z - az;
+      length = std::sqrt(sx * sx + sz * sz);
+      if (length < 1e-4f) {
+        continue;
+      }
+      ux = sx / length;
+      uz = sz / length;
+    } else {
+      length = wake_length - travelled;
+    }
+    float px = p_x - ax;
+    float pz = p_z - az;
+    float along = px * ux + pz * uz;
+    // Past the source counts as ahead of it
+    float t = std::min(along, length);
+    if (k > 0) {
+      t = std::max(t, 0.0f);
+    }
+    float cx = px - ux * t;
+    float cz = pz - uz * t;
+    float across = std::sqrt(cx * cx + cz * cz);
+    if (across < best_across) {
+      best_across = across;
+      best_behind = travelled + t;
+      dir_x = -ux;
+      dir_z = -uz;
+      side_x = across > 1e-4f ? cx / across : 0.0f;
+      side_z = across > 1e-4f ? cz / across : 0.0f;
+    }
+    travelled += length;
+    ax += ux * length;
+    az += uz * length;
+  }
+
+  float behind = best_behind;
+  float across = best_across;
+  if (behind <= 0.5f || behind > wake_length) {
+    return;
+  }
+  float ratio = across / std::max(behind, 0.1f);
+  float envelope = smoothstep(WAKE_HALF_ANGLE, 0.28f, ratio);
+  if (envelope < 0.01f) {
+    return;
+  }
+  float amplitude = source.active_strength * 0.4f * envelope *
+                    smoothstep(0.0f, 0.08f, ratio) *
+                    smoothstep(wake_length, wake_length * 0.5f, behind) /
+                    std::max(std::sqrt(behind), 1.0f);
+  float mix = smoothstep(0.15f, 0.35f, ratio);
+
+  // Transverse waves cross the track, divergent ones run along the arms
+  float k = 6.2831853f * speed / WAKE_GRAVITY;
+  float distance = std::sqrt(behind * behind + across * across);
+  float transverse_phase = behind * k * 0.3f;
+  float divergent_phase = distance * k * 0.5f - behind * k * 0.15f;
+  float transverse = amplitude * (1.0f - mix) * 0.7f;
+  float divergent = amplitude * mix * 0.5f;
+  float transverse_h = transverse * std::sin(transverse_phase);
+  float divergent_h = divergent * std::sin(divergent_phase);
+  r_height += transverse_h + divergent_h;
+
+  // The pattern is steady in the source's frame, so it moves past a fixed
+  // point at the source's speed: behind grows at speed, distance at
+  // speed * behind / distance. That gives the surface's rise rate, and
+  // the orbital velocity omega * h along each wave's direction of travel.
+  float transverse_rate = k * 0.3f * speed;
+  float divergent_rate =
+      k * speed * (0.5f * behind / std::max(distance, 1e-4f) - 0.15f);
+  r_velocity.y += transverse * std::cos(transverse_phase) * transverse_rate +
+                  divergent * std::cos(divergent_phase) * divergent_rate;
+
+  // Transverse waves travel with the source
+  r_velocity.x += transverse_rate * transverse_h * dir_x;
+  r_velocity.z += transverse_rate * transverse_h * dir_z;
+  // Divergent phase gradient: 0.5 d(distance) - 0.15 d(behind), with
+  // d(behind) = -dir and d(distance) = (across * side - behind * dir) / distance
+  float inv_distance = 1.0f / std::max(distance, 1e-4f);
+  float gx = 0.5f * (across * side_x - behind * dir_x) * inv_distance +
+             0.15f * dir_x;
+  float gz = 0.5f * (across * side_z - behind * dir_z) * inv_distance +
+             0.15f * dir_z;
+  float g_length = std::sqrt(gx * gx + gz * gz);
+  if (g_length > 1e-4f) {
+    float scale = -divergent_rate * divergent_h / g_length;
+    r_velocity.x += scale * gx;
+    r_velocity.z += scale * gz;
+  }
+}
+
+void OceanWakeField::sample(const Vector3 *p_positions, int p_count,
+                            float *r_heights, Vector3 *r_velocities) const {
+  float inv_cell = 1.0f / _cell_size;
+  // Neighbouring query points mostly share a cell; keep its range
+  uint64_t cached_key = 0;
+  bool cached = false;
+  std::vector<std::pair<uint64_t, int>>::const_iterator first, last;
+  for (int i = 0; i < p_count; i++) {
+    float x = p_positions[i].x;
+    float z = p_positions[i].z;
+    uint64_t key = _cell_key((int)std::floor(x * inv_cell),
+                             (int)std::floor(z * inv_cell));
+    if (!cached || key != cached_key) {
+      first = std::lower_bound(_bins.begin(), _bins.end(),
+                               std::make_pair(key, -1));
+      last = first;
+      while (last != _bins.end() && last->first == key) {
+        ++last;
+      }
+      cached_key = key;
+      cached = true;
+    }
+    float height = 0.0f;
+    Vector3 velocity;
+    for (std::vector<std::pair<uint64_t, int>>::const_iterator it = first;
+         it != last; ++it) {
+      _accumulate(it->second, x, z, height, velocity);
+    }
+    // Same limit as the shader
+    r_heights[i] = std::min(std::max(height, -0.8f), 0.8f);
+    if (r_velocities) {
+      r_velocities[i] = velocity;
+    }
+  }
+}
+
+PackedFloat32Array
+OceanWakeField::get_wake_heights(const PackedVector3Array &p_positions) const {
+  PackedFloat32Array result;
+  result.resize(p_positions.size());
+  sample(p_positions.ptr(), (int)p_positions.size(), result.ptrw(), nullptr);
+  return result;
+}
+
+PackedVector3Array OceanWakeField::get_wake_velocities(
+    const PackedVector3Array &p_positions) const {
+  int count = (int)p_positions.size();
+  std::vector<float> heights(count);
+  PackedVector3Array result;
+  result.resize(count);
+  sample(p_positions.ptr(), count, heights.data(), result.ptrw());
+  return result;
+}
+
+void OceanWakeField::set_max_wake_length(float p_length) {
+  _max_wake_length = std::max(p_length, 1.0f);
+}
+float OceanWakeField::get_max_wake_length() const { return _max_wake_length; }
+
+void OceanWakeField::set_path_spacing(float p_spacing) {
+  _path_spacing = std::max(p_spacing, 0.05f);
+}
+float OceanWakeField::get_path_spacing() const { return _path_spacing; }
+
+void OceanWakeField::set_cell_size(float p_size) {
+  _cell_size = std::max(p_size, 1.0f);
+  _rebuild_bins();
+}
+float OceanWakeField::get_cell_size() const { return _cell_size; }
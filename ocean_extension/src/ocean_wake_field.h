@@ -0,0 +1,104 @@
+#ifndef OCEAN_WAKE_FIELD_H
+#define OCEAN_WAKE_FIELD_H
+
+#include <godot_cpp/classes/node.hpp>
+#include <godot_cpp/classes/node3d.hpp>
+#include <godot_cpp/core/class_db.hpp>
+#include <godot_cpp/variant/packed_float32_array.hpp>
+#include <godot_cpp/variant/packed_vector3_array.hpp>
+#include <godot_cpp/variant/vector3.hpp>
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace godot {
+
+// Kelvin wakes of moving nodes, evaluated on the CPU so they can push
+// boats and not only shade the surface. Each source keeps the path it
+// travelled; the wedge follows that path through turns instead of
+// pointing straight back from the current heading. Height and surface
+// velocity are analytic, with the same pattern as kelvin_wake_height()
+// in ocean_surface.gdshader.
+//
+// Sources are binned into a coarse grid every tick, so a query only
+// visits the wakes near it.
+class OceanWakeField : public Node {
+  GDCLASS(OceanWakeField, Node)
+
+private:
+  // One recorded position of a source, newest first in the history
+  struct PathPoint {
+    float x = 0.0f;
+    float z = 0.0f;
+  };
+
+  struct Source {
+    uint64_t node_id = 0;
+    float strength = 1.0f;
+    Vector3 last_position;
+    float dir_x = 0.0f; // last heading, kept while stopping
+    float dir_z = 0.0f;
+    float active_strength = 0.0f; // ramps in and out with motion
+    float speed = 0.0f;           // decays after stopping
+    float wake_length = 0.0f;
+    std::vector<PathPoint> path; // ring, path_head is the newest
+    int path_head = 0;
+    int path_count = 0;
+  };
+
+  std::vector<Source> _sources;
+
+  // m, at full speed; WaterManager passes it to ocean_surface.gdshader as
+  // kelvin_wake_max_length so the drawn wake ends at the same distance
+  float _max_wake_length = 12.0f;
+  float _path_spacing = 0.5f;     // m between recorded path points
+  float _cell_size = 16.0f;       // m, side of a binning cell
+
+  // (cell key, source index), sorted by key; rebuilt every tick
+  std::vector<std::pair<uint64_t, int>> _bins;
+
+  int _find_source(uint64_t p_node_id) const;
+  void _update_source(Source &r_source, const Vector3 &p_position,
+                      float p_delta);
+  void _rebuild_bins();
+  uint64_t _cell_key(int p_x, int p_z) const;
+  // Adds source p_index's height and velocity at (x, z)
+  void _accumulate(int p_index, float p_x, float p_z, float &r_height,
+                   Vector3 &r_velocity) const;
+
+protected:
+  static void _bind_methods();
+
+public:
+  OceanWakeField();
+  ~OceanWakeField();
+
+  void _physics_process(double delta) override;
+
+  void register_source(Node3D *p_node, float p_strength);
+  void unregister_source(Node3D *p_node);
+  int get_source_count() const;
+
+  // Wake height (m) and surface velocity (m/s) at p_count points;
+  // r_velocities may be null
+  void sample(const Vector3 *p_positions, int p_count, float *r_heights,
+              Vector3 *r_velocities) const;
+  PackedFloat32Array
+  get_wake_heights(const PackedVector3Array &p_positions) const;
+  PackedVector3Array
+  get_wake_velocities(const PackedVector3Array &p_positions) const;
+
+  void set_max_wake_length(float p_length);
+  float get_max_wake_length() const;
+
+  void set_path_spacing(float p_spacing);
+  float get_path_spacing() const;
+
+  void set_cell_size(float p_size);
+  float get_cell_size() const;
+};
+
+} // namespace godot
+
+#endif
@@ -6,6 +6,11 @@
 #include <godot_cpp/godot.hpp>
 
 #include "ocean_buoyancy_sampler_3d.h"
+#include "ocean_flotsam_3d.h"
+#include "ocean_obstacle_rasterizer.h"
+#include "ocean_shallow_water.h"
+#include "ocean_splatter.h"
+#include "ocean_wake_field.h"
 
 using namespace godot;
 
@@ -15,6 +20,11 @@ void initialize_ocean_extension_module(ModuleInitializationLevel p_level) {
   }
 
   ClassDB::register_class<OceanBuoyancySampler3D>();
+  ClassDB::register_class<OceanFlotsam3D>();
+  ClassDB::register_class<OceanWakeField>();
+  ClassDB::register_class<OceanShallowWater>();
+  ClassDB::register_class<OceanObstacleRasterizer>();
+  ClassDB::register_class<OceanSplatter>();
 }
 
 void uninitialize_ocean_extension_module(ModuleInitializationLevel p_level) {